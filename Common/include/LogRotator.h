@@ -0,0 +1,346 @@
+#ifndef LOG_ROTATOR_H
+#define LOG_ROTATOR_H
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <deque>
+#include <filesystem>
+#include <iostream>
+#include <limits>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#ifdef LOG_ROTATION_GZIP
+#include <zlib.h>
+#endif
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+enum class RotationInterval {
+    None,
+    Hourly, // at every full hour of local time
+    Daily,  // at local midnight
+    Monthly // at local midnight of the first day of a month
+};
+
+struct RotationPolicy {
+    std::uint64_t max_bytes = 0;   // rotate once the file would grow past this, 0 - no limit
+    RotationInterval interval = RotationInterval::None;
+    int keep_files = 0;            // rotated files kept, 0 - no limit
+    int max_age_days = 0;          // rotated files older than this are removed, 0 - no limit
+
+    bool enabled() const {
+        return max_bytes > 0 || interval != RotationInterval::None;
+    }
+};
+
+// Rotates one log file. The owner of the file asks should_rotate() before
+// every write (two comparisons), and when it says so calls rotate() with a
+// callback that opens `path` again. rotate() only renames the file to
+// "<path>.YYYYMMDD-HHMMSS"; compressing it to ".gz" (when built with zlib,
+// LOG_ROTATION_GZIP) and removing rotated files past the retention limits
+// happen on a background thread with the lowest scheduling priority.
+// Rotated files left uncompressed by a previous run are picked up at start.
+class LogRotator {
+public:
+    LogRotator(std::string path, RotationPolicy policy)
+        : path_(std::move(path)), policy_(policy), next_boundary_(next_boundary(std::time(nullptr))) {
+        worker_ = std::thread(&LogRotator::worker_loop, this);
+    }
+
+    ~LogRotator() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        wakeup_.notify_one();
+        worker_.join();
+    }
+
+    LogRotator(const LogRotator&) = delete;
+    LogRotator& operator=(const LogRotator&) = delete;
+
+    const std::string& path() const {
+        return path_;
+    }
+
+    // `size` is the current file size plus the bytes about to be written.
+    bool should_rotate(std::uint64_t size, std::time_t now) const {
+        return (policy_.max_bytes > 0 && size > policy_.max_bytes) || now >= next_boundary_;
+    }
+
+    // Renames the file away and calls reopen(), which opens `path` again and
+    // returns false if it could not. When either step fails the file is put
+    // back under `path` and false is returned, so the owner keeps writing to
+    // the descriptor it has. A missing or empty file is left in place.
+    template <typename Reopen>
+    bool rotate(std::time_t now, Reopen&& reopen) {
+        next_boundary_ = next_boundary(now);
+
+        std::error_code error;
+        if (!std::filesystem::exists(path_, error) || std::filesystem::file_size(path_, error) == 0) {
+            return reopen();
+        }
+        std::string target = rotated_name(now);
+        std::filesystem::rename(path_, target, error);
+        if (error) {
+            std::cerr << "Failed to rotate " << path_ << ": " << error.message() << std::endl;
+            return false;
+        }
+        if (!reopen()) {
+            std::filesystem::rename(target, path_, error);
+            return false;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            queue_.push_back(target);
+        }
+        wakeup_.notify_one();
+        return true;
+    }
+
+    // For owners that do not track the size: checks the file itself.
+    bool rotate_if_needed() {
+        std::time_t now = std::time(nullptr);
+        std::error_code error;
+        std::uint64_t size = std::filesystem::file_size(path_, error);
+        if (error) {
+            size = 0;
+        }
+        return should_rotate(size, now) ? rotate(now, [] { return true; }) : false;
+    }
+
+    // Rotated files of the log at `path`, oldest first, with their rotation
+    // time: every line in a file was written before it and after the rotation
+    // time of the previous file. Compressed ones end in ".gz".
+    static std::vector<std::pair<std::string, std::time_t>> rotated_files(const std::string& path) {
+        struct Rotated {
+            std::time_t time;
+            int sequence; // the "-N" of files rotated within the same second
+            std::string path;
+            bool operator<(const Rotated& other) const {
+                return time != other.time ? time < other.time : sequence < other.sequence;
+            }
+        };
+        std::vector<Rotated> found;
+        std::filesystem::path log_path(path);
+        std::filesystem::path directory = log_path.has_parent_path() ? log_path.parent_path() : ".";
+        std::string prefix = log_path.filename().string() + ".";
+
+        std::error_code error;
+        for (std::filesystem::directory_iterator it(directory, error), end; !error && it != end; it.increment(error)) {
+            std::string name = it->path().filename().string();
+            if (name.compare(0, prefix.size(), prefix) != 0 || name.size() < prefix.size() + STAMP_LENGTH ||
+                ends_with(name, ".tmp")) {
+                continue;
+            }
+            std::tm local{};
+            if (std::sscanf(name.c_str() + prefix.size(), "%4d%2d%2d-%2d%2d%2d", &local.tm_year, &local.tm_mon,
+                            &local.tm_mday, &local.tm_hour, &local.tm_min, &local.tm_sec) != 6) {
+                continue;
+            }
+            local.tm_year -= 1900;
+            local.tm_mon -= 1;
+            local.tm_isdst = -1;
+            int sequence = 0;
+            if (name[prefix.size() + STAMP_LENGTH] == '-') {
+                sequence = std::atoi(name.c_str() + prefix.size() + STAMP_LENGTH + 1);
+            }
+            found.push_back({ std::mktime(&local), sequence, it->path().string() });
+        }
+        std::sort(found.begin(), found.end());
+
+        std::vector<std::pair<std::string, std::time_t>> files;
+        for (const Rotated& file : found) {
+            files.emplace_back(file.path, file.time);
+        }
+        return files;
+    }
+
+private:
+    static constexpr std::size_t STAMP_LENGTH = 15; // YYYYMMDD-HHMMSS
+
+    std::time_t next_boundary(std::time_t now) const {
+        if (policy_.interval == RotationInterval::None) {
+            return std::numeric_limits<std::time_t>::max();
+        }
+        std::tm local = local_time(now);
+        local.tm_min = 0;
+        local.tm_sec = 0;
+        if (policy_.interval == RotationInterval::Hourly) {
+            local.tm_hour += 1;
+        } else if (policy_.interval == RotationInterval::Daily) {
+            local.tm_hour = 0;
+            local.tm_mday += 1;
+        } else {
+            local.tm_hour = 0;
+            local.tm_mday = 1;
+            local.tm_mon += 1;
+        }
+        local.tm_isdst = -1;
+        return std::mktime(&local);
+    }
+
+    static std::tm local_time(std::time_t time) {
+        std::tm local{};
+#ifdef _WIN32
+        localtime_s(&local, &time);
+#else
+        localtime_r(&time, &local);
+#endif
+        return local;
+    }
+
+    std::string rotated_name(std::time_t now) const {
+        std::tm local = local_time(now);
+        char stamp[STAMP_LENGTH + 1];
+        std::strftime(stamp, sizeof(stamp), "%Y%m%d-%H%M%S", &local);
+        std::string base = path_ + "." + stamp;
+        std::string name = base;
+        std::error_code error;
+        for (int n = 1; std::filesystem::exists(name, error) || std::filesystem::exists(name + ".gz", error); ++n) {
+            name = base + "-" + std::to_string(n);
+        }
+        return name;
+    }
+
+    static void lower_thread_priority() {
+#ifdef _WIN32
+        SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_LOWEST);
+#elif defined(__linux__)
+        // Nice values are per thread on Linux.
+        setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)), 19);
+#endif
+    }
+
+    static bool ends_with(const std::string& value, const std::string& suffix) {
+        return value.size() >= suffix.size() && value.compare(value.size() - suffix.size(), suffix.size(), suffix) == 0;
+    }
+
+    // Writes "<file>.gz" next to `file` and removes `file`. The archive gets
+    // its final name only when complete, so a crash leaves at most a ".tmp".
+    static void compress(const std::string& file) {
+#ifdef LOG_ROTATION_GZIP
+        std::string target = file + ".gz";
+        std::string temporary = target + ".tmp";
+        FILE* in = std::fopen(file.c_str(), "rb");
+        if (!in) {
+            return;
+        }
+        gzFile out = gzopen(temporary.c_str(), "wb6");
+        bool ok = out != nullptr;
+        char buffer[64 * 1024];
+        while (ok) {
+            std::size_t n = std::fread(buffer, 1, sizeof(buffer), in);
+            if (n == 0) {
+                ok = !std::ferror(in);
+                break;
+            }
+            ok = gzwrite(out, buffer, static_cast<unsigned>(n)) == static_cast<int>(n);
+        }
+        std::fclose(in);
+        if (out && gzclose(out) != Z_OK) {
+            ok = false;
+        }
+
+        std::error_code error;
+        if (ok) {
+            std::filesystem::rename(temporary, target, error);
+            ok = !error;
+        }
+        if (ok) {
+            std::filesystem::remove(file, error);
+        } else {
+            std::cerr << "Failed to compress " << file << std::endl;
+            std::filesystem::remove(temporary, error);
+        }
+#else
+        (void)file;
+#endif
+    }
+
+    void apply_retention() const {
+        if (policy_.keep_files <= 0 && policy_.max_age_days <= 0) {
+            return;
+        }
+        auto files = rotated_files(path_);
+        std::time_t oldest = std::time(nullptr) - static_cast<std::time_t>(policy_.max_age_days) * 24 * 3600;
+        std::size_t excess = policy_.keep_files > 0 && files.size() > static_cast<std::size_t>(policy_.keep_files)
+                                 ? files.size() - policy_.keep_files
+                                 : 0;
+        std::error_code error;
+        for (std::size_t i = 0; i < files.size(); ++i) {
+            if (i < excess || (policy_.max_age_days > 0 && files[i].second < oldest)) {
+                std::filesystem::remove(files[i].first, error);
+            }
+        }
+    }
+
+    void worker_loop() {
+        lower_thread_priority();
+
+#ifdef LOG_ROTATION_GZIP
+        for (const auto& file : rotated_files(path_)) {
+            if (!ends_with(file.first, ".gz")) {
+                std::lock_guard<std::mutex> lock(mutex_);
+                queue_.push_back(file.first);
+            }
+        }
+#endif
+        bool cleanup_due = true;
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (true) {
+            // Age based retention is checked at least hourly, even without rotations.
+            wakeup_.wait_for(lock, std::chrono::hours(1), [this]() { return stop_ || !queue_.empty(); });
+            // Files still queued at stop are compressed by the next run.
+            while (!queue_.empty() && !stop_) {
+                std::string file = queue_.front();
+                queue_.pop_front();
+                lock.unlock();
+                compress(file);
+                lock.lock();
+                cleanup_due = true;
+            }
+            if (stop_) {
+                break;
+            }
+            lock.unlock();
+            if (cleanup_due || policy_.max_age_days > 0) {
+                apply_retention();
+                cleanup_due = false;
+            }
+            lock.lock();
+        }
+        lock.unlock();
+        if (cleanup_due) {
+            apply_retention();
+        }
+    }
+
+    const std::string path_;
+    const RotationPolicy policy_;
+    std::time_t next_boundary_;
+
+    std::thread worker_;
+    std::mutex mutex_;
+    std::condition_variable wakeup_;
+    std::deque<std::string> queue_;
+    bool stop_ = false;
+};
+
+#endif
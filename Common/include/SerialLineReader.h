@@ -0,0 +1,199 @@
+#ifndef SERIAL_LINE_READER_H
+#define SERIAL_LINE_READER_H
+
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <string_view>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+#endif
+
+// Range of the temperature sensors the labs read, in degrees Celsius. A
+// reading outside it can only come from a garbled frame.
+constexpr float MIN_READING = -55.0f;
+constexpr float MAX_READING = 125.0f;
+
+// Parses a frame holding exactly one reading, e.g. "21.500000". Surrounding
+// blanks are allowed; unlike std::stof anything else after the number makes
+// the frame invalid instead of being ignored. "nan", "inf" and values outside
+// [MIN_READING, MAX_READING] are rejected as well.
+inline bool parseReading(std::string_view frame, float& value) {
+    auto isBlank = [](char c) { return c == ' ' || c == '\t' || c == '\r'; };
+    while (!frame.empty() && isBlank(frame.front())) {
+        frame.remove_prefix(1);
+    }
+    while (!frame.empty() && isBlank(frame.back())) {
+        frame.remove_suffix(1);
+    }
+    if (!frame.empty() && frame.front() == '+') {
+        frame.remove_prefix(1);
+    }
+    if (frame.empty()) {
+        return false;
+    }
+    const char* end = frame.data() + frame.size();
+    float parsedValue;
+    auto parsed = std::from_chars(frame.data(), end, parsedValue);
+    if (parsed.ec != std::errc() || parsed.ptr != end || !std::isfinite(parsedValue) ||
+        parsedValue < MIN_READING || parsedValue > MAX_READING) {
+        return false;
+    }
+    value = parsedValue;
+    return true;
+}
+
+// Splits the byte stream of a serial port into newline-terminated frames.
+// Bytes are read as they arrive and kept until their newline does, so a
+// frame split across reads is reassembled and several frames read at once
+// are all handed out. On Linux the port is switched to non-blocking mode and
+// waited on with epoll; on Windows ReadFile is set up to return as soon as
+// any byte is received. A frame longer than MAX_FRAME is dropped.
+class SerialLineReader {
+public:
+    static constexpr std::size_t MAX_FRAME = 4096;
+
+#ifdef _WIN32
+    explicit SerialLineReader(HANDLE port) : port_(port) {
+    }
+#else
+    explicit SerialLineReader(int fd) : fd_(fd) {
+        int flags = fcntl(fd_, F_GETFL);
+        if (flags == -1 || fcntl(fd_, F_SETFL, flags | O_NONBLOCK) == -1) {
+            perror("Failed to make serial port non-blocking");
+            return;
+        }
+        epoll_ = epoll_create1(EPOLL_CLOEXEC);
+        if (epoll_ == -1) {
+            perror("Failed to create epoll instance");
+            return;
+        }
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.fd = fd_;
+        if (epoll_ctl(epoll_, EPOLL_CTL_ADD, fd_, &event) == -1) {
+            perror("Failed to watch serial port");
+            close(epoll_);
+            epoll_ = -1;
+        }
+    }
+
+    ~SerialLineReader() {
+        if (epoll_ != -1) {
+            close(epoll_);
+        }
+    }
+#endif
+
+    SerialLineReader(const SerialLineReader&) = delete;
+    SerialLineReader& operator=(const SerialLineReader&) = delete;
+
+    // Waits up to `timeout` for input and calls onFrame(std::string_view) for
+    // every complete frame, without its line ending; empty frames are
+    // skipped. Returns false once the port fails or is closed.
+    template <typename OnFrame>
+    bool poll(std::chrono::milliseconds timeout, OnFrame&& onFrame) {
+        if (!readAvailable(timeout)) {
+            return false;
+        }
+        std::size_t start = 0;
+        for (std::size_t newline; (newline = buffer_.find('\n', start)) != std::string::npos; start = newline + 1) {
+            std::string_view frame(buffer_.data() + start, newline - start);
+            if (!frame.empty() && frame.back() == '\r') {
+                frame.remove_suffix(1);
+            }
+            if (!discarding_ && !frame.empty()) {
+                onFrame(frame);
+            }
+            discarding_ = false;
+        }
+        buffer_.erase(0, start);
+        if (buffer_.size() > MAX_FRAME) {
+            std::cerr << "Dropping a serial frame longer than " << MAX_FRAME << " bytes" << std::endl;
+            buffer_.clear();
+            discarding_ = true;
+        }
+        return true;
+    }
+
+private:
+#ifdef _WIN32
+    bool readAvailable(std::chrono::milliseconds timeout) {
+        if (timeout != timeout_) {
+            // Return as soon as a byte has arrived, or after `timeout`.
+            COMMTIMEOUTS timeouts = {0};
+            timeouts.ReadIntervalTimeout = MAXDWORD;
+            timeouts.ReadTotalTimeoutMultiplier = MAXDWORD;
+            timeouts.ReadTotalTimeoutConstant = static_cast<DWORD>(timeout.count());
+            if (!SetCommTimeouts(port_, &timeouts)) {
+                std::cerr << "Error setting timeouts" << std::endl;
+                return false;
+            }
+            timeout_ = timeout;
+        }
+        char chunk[512];
+        DWORD bytesRead = 0;
+        if (!ReadFile(port_, chunk, sizeof(chunk), &bytesRead, nullptr)) {
+            std::cerr << "Error reading from serial port" << std::endl;
+            return false;
+        }
+        buffer_.append(chunk, bytesRead);
+        return true;
+    }
+
+    HANDLE port_;
+    std::chrono::milliseconds timeout_{-1};
+#else
+    // Waits for the port to become readable and drains it.
+    bool readAvailable(std::chrono::milliseconds timeout) {
+        if (epoll_ == -1) {
+            return false;
+        }
+        epoll_event event;
+        int ready = epoll_wait(epoll_, &event, 1, static_cast<int>(timeout.count()));
+        if (ready == -1) {
+            if (errno == EINTR) {
+                return true;
+            }
+            perror("Error waiting for serial port");
+            return false;
+        }
+        if (ready == 0) {
+            return true;
+        }
+        char chunk[4096];
+        while (true) {
+            ssize_t bytesRead = read(fd_, chunk, sizeof(chunk));
+            if (bytesRead > 0) {
+                buffer_.append(chunk, static_cast<std::size_t>(bytesRead));
+            } else if (bytesRead == 0) {
+                std::cerr << "Serial port closed" << std::endl;
+                return false;
+            } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                return true;
+            } else if (errno != EINTR) {
+                perror("Error reading from serial port");
+                return false;
+            }
+        }
+    }
+
+    int fd_;
+    int epoll_ = -1;
+#endif
+
+    std::string buffer_;
+    bool discarding_ = false; // the rest of an over-long frame is still coming
+};
+
+#endif
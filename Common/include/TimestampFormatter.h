@@ -0,0 +1,82 @@
+#ifndef TIMESTAMP_FORMATTER_H
+#define TIMESTAMP_FORMATTER_H
+
+#include <chrono>
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+
+#ifndef _WIN32
+#include <time.h>
+#endif
+
+// Formats wall clock timestamps as "YYYY-MM-DD HH:MM:SS.mmm" for log lines.
+// The "YYYY-MM-DD HH:MM:SS." part is built with localtime/strftime once per
+// second and cached, every other call only patches in the milliseconds.
+// An instance is not thread-safe, keep one per logging thread.
+class TimestampFormatter {
+public:
+    static constexpr std::size_t LENGTH = 23;
+
+    // Current wall clock time in nanoseconds since the epoch (vDSO clock_gettime on Linux).
+    static std::int64_t now_ns() {
+#ifdef _WIN32
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+#else
+        struct timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        return static_cast<std::int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+#endif
+    }
+
+    // Writes exactly LENGTH characters to `out`, without a terminating zero.
+    std::size_t format(std::int64_t timestamp_ns, char* out) {
+        std::int64_t second = timestamp_ns / 1000000000;
+        std::int64_t nanos = timestamp_ns % 1000000000;
+        if (nanos < 0) {
+            --second;
+            nanos += 1000000000;
+        }
+
+        if (second != cached_second_) {
+            cache_second(second);
+        }
+
+        std::memcpy(out, cached_prefix_, PREFIX_LENGTH);
+        int ms = static_cast<int>(nanos / 1000000);
+        out[PREFIX_LENGTH] = static_cast<char>('0' + ms / 100);
+        out[PREFIX_LENGTH + 1] = static_cast<char>('0' + ms / 10 % 10);
+        out[PREFIX_LENGTH + 2] = static_cast<char>('0' + ms % 10);
+        return LENGTH;
+    }
+
+    std::size_t format_now(char* out) {
+        return format(now_ns(), out);
+    }
+
+private:
+    static constexpr std::size_t PREFIX_LENGTH = 20; // "YYYY-MM-DD HH:MM:SS."
+
+    void cache_second(std::int64_t second) {
+        std::time_t t = static_cast<std::time_t>(second);
+        std::tm tm{};
+#ifdef _WIN32
+        localtime_s(&tm, &t);
+#else
+        localtime_r(&t, &tm);
+#endif
+        char buffer[32];
+        if (strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S.", &tm) != PREFIX_LENGTH) {
+            std::memset(buffer, '?', PREFIX_LENGTH);
+        }
+        std::memcpy(cached_prefix_, buffer, PREFIX_LENGTH);
+        cached_second_ = second;
+    }
+
+    std::int64_t cached_second_ = LLONG_MIN;
+    char cached_prefix_[PREFIX_LENGTH] = {};
+};
+
+#endif
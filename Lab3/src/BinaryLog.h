@@ -0,0 +1,38 @@
+#ifndef BINARY_LOG_H
+#define BINARY_LOG_H
+
+#include <cstdint>
+#include <string>
+
+// Binary log layout, written in host byte order:
+//   <log>      BinaryLogHeader followed by fixed-size BinaryLogRecord entries
+//   <log>.str  string arena, record text is stored at text_offset
+// Wall clock time of a record is monotonic_ns plus the payload of the last
+// EVENT_CLOCK_ANCHOR record before it.
+
+constexpr char BINARY_LOG_MAGIC[8] = { 'T', 'M', 'R', 'B', 'L', 'O', 'G', '1' };
+constexpr std::uint32_t BINARY_LOG_VERSION = 1;
+
+struct BinaryLogHeader {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t record_size;
+};
+
+struct BinaryLogRecord {
+    std::int64_t monotonic_ns;
+    std::int64_t payload;
+    std::uint64_t text_offset;
+    std::uint32_t pid;
+    std::uint16_t event;
+    std::uint16_t text_length;
+};
+
+static_assert(sizeof(BinaryLogHeader) == 16, "BinaryLogHeader must stay 16 bytes");
+static_assert(sizeof(BinaryLogRecord) == 32, "BinaryLogRecord must stay 32 bytes");
+
+inline std::string binary_log_arena_path(const std::string& log_path) {
+    return log_path + ".str";
+}
+
+#endif
@@ -0,0 +1,9 @@
+#ifndef CACHE_LINE_H
+#define CACHE_LINE_H
+
+#include <cstddef>
+
+// Every field that is written by several processes gets its own cache line.
+constexpr std::size_t CACHE_LINE_SIZE = 64;
+
+#endif
@@ -0,0 +1,277 @@
+#include "ChildReaper.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#ifndef _WIN32
+#include <sys/wait.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdio>
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/syscall.h>
+#endif
+#endif
+
+namespace {
+
+std::mutex reaper_mutex;
+
+#ifdef _WIN32
+
+struct WatchedChild {
+    HANDLE process;
+    HANDLE wait;
+    ChildExitHandler on_exit;
+    std::atomic<bool> done;
+};
+
+std::vector<WatchedChild*> watched;
+
+// A wait registration can only be released outside its own callback, so
+// finished entries are freed on the next watch_child() or at stop.
+void release_finished(bool all) {
+    for (auto it = watched.begin(); it != watched.end();) {
+        WatchedChild* child = *it;
+        if (all || child->done) {
+            UnregisterWaitEx(child->wait, INVALID_HANDLE_VALUE);
+            CloseHandle(child->process);
+            delete child;
+            it = watched.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void CALLBACK child_exited(PVOID context, BOOLEAN) {
+    auto* child = static_cast<WatchedChild*>(context);
+    DWORD code = 0;
+    GetExitCodeProcess(child->process, &code);
+    child->on_exit(static_cast<int>(code));
+    child->done = true;
+}
+
+#else
+
+constexpr int POLL_INTERVAL_MS = 100;
+
+std::thread reaper_thread;
+std::atomic<bool> reaper_stop(false);
+
+// Children without a pidfd are polled with waitpid(WNOHANG).
+std::unordered_map<pid_t, ChildExitHandler> polled_children;
+
+#ifdef __linux__
+struct PidfdChild {
+    pid_t pid;
+    ChildExitHandler on_exit;
+};
+
+int epoll_fd = -1;
+int wake_fd = -1;
+std::unordered_map<int, PidfdChild> pidfd_children;
+
+int open_pidfd(pid_t pid) {
+#ifdef SYS_pidfd_open
+    return static_cast<int>(syscall(SYS_pidfd_open, pid, 0));
+#else
+    (void)pid;
+    errno = ENOSYS;
+    return -1;
+#endif
+}
+
+void reap_pidfd(int fd) {
+    PidfdChild child;
+    {
+        std::lock_guard<std::mutex> lock(reaper_mutex);
+        auto it = pidfd_children.find(fd);
+        if (it == pidfd_children.end()) {
+            return;
+        }
+        child = std::move(it->second);
+        pidfd_children.erase(it);
+    }
+    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+    close(fd);
+
+    int status = 0;
+    while (waitpid(child.pid, &status, 0) == -1 && errno == EINTR) {
+    }
+    child.on_exit(status);
+}
+#endif
+
+void poll_children() {
+    std::vector<std::pair<ChildExitHandler, int>> exited;
+    {
+        std::lock_guard<std::mutex> lock(reaper_mutex);
+        for (auto it = polled_children.begin(); it != polled_children.end();) {
+            int status = 0;
+            if (waitpid(it->first, &status, WNOHANG) != 0) {
+                exited.emplace_back(std::move(it->second), status);
+                it = polled_children.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+    for (auto& child : exited) {
+        child.first(child.second);
+    }
+}
+
+bool has_polled_children() {
+    std::lock_guard<std::mutex> lock(reaper_mutex);
+    return !polled_children.empty();
+}
+
+void reaper_loop() {
+    while (!reaper_stop.load(std::memory_order_acquire)) {
+        int timeout = has_polled_children() ? POLL_INTERVAL_MS : -1;
+#ifdef __linux__
+        struct epoll_event events[16];
+        int count = epoll_wait(epoll_fd, events, 16, timeout);
+        if (count == -1 && errno != EINTR) {
+            perror("Child reaper epoll_wait failed");
+            return;
+        }
+        for (int i = 0; i < count; ++i) {
+            if (events[i].data.fd == wake_fd) {
+                std::uint64_t value;
+                if (read(wake_fd, &value, sizeof(value)) == -1 && errno != EAGAIN) {
+                    perror("Child reaper eventfd read failed");
+                }
+            } else {
+                reap_pidfd(events[i].data.fd);
+            }
+        }
+#else
+        (void)timeout;
+        std::this_thread::sleep_for(std::chrono::milliseconds(POLL_INTERVAL_MS));
+#endif
+        poll_children();
+    }
+}
+
+#endif
+
+}
+
+#ifdef _WIN32
+
+void start_child_reaper() {
+}
+
+void stop_child_reaper() {
+    std::lock_guard<std::mutex> lock(reaper_mutex);
+    release_finished(true);
+}
+
+void watch_child(ChildHandle child, ChildExitHandler on_exit) {
+    std::lock_guard<std::mutex> lock(reaper_mutex);
+    release_finished(false);
+
+    auto* entry = new WatchedChild{ child, nullptr, std::move(on_exit), false };
+    if (!RegisterWaitForSingleObject(&entry->wait, child, child_exited, entry, INFINITE, WT_EXECUTEONLYONCE)) {
+        std::cerr << "Failed to watch child process: " << GetLastError() << std::endl;
+        CloseHandle(child);
+        delete entry;
+        return;
+    }
+    watched.push_back(entry);
+}
+
+#else
+
+void start_child_reaper() {
+    if (reaper_thread.joinable()) {
+        return;
+    }
+#ifdef __linux__
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    wake_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (epoll_fd == -1 || wake_fd == -1) {
+        perror("Could not create child reaper");
+        exit(1);
+    }
+    struct epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.fd = wake_fd;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, wake_fd, &event);
+#endif
+    reaper_stop = false;
+    reaper_thread = std::thread(reaper_loop);
+}
+
+void stop_child_reaper() {
+    if (!reaper_thread.joinable()) {
+        return;
+    }
+    reaper_stop.store(true, std::memory_order_release);
+#ifdef __linux__
+    std::uint64_t one = 1;
+    if (write(wake_fd, &one, sizeof(one)) == -1) {
+        perror("Could not stop child reaper");
+    }
+#endif
+    reaper_thread.join();
+
+    // Children still running are left to init, only the descriptors are released.
+    std::lock_guard<std::mutex> lock(reaper_mutex);
+#ifdef __linux__
+    for (auto& child : pidfd_children) {
+        close(child.first);
+    }
+    pidfd_children.clear();
+    close(wake_fd);
+    close(epoll_fd);
+    wake_fd = -1;
+    epoll_fd = -1;
+#endif
+    polled_children.clear();
+}
+
+void watch_child(ChildHandle child, ChildExitHandler on_exit) {
+#ifdef __linux__
+    int fd = open_pidfd(child);
+    if (fd != -1) {
+        {
+            std::lock_guard<std::mutex> lock(reaper_mutex);
+            pidfd_children[fd] = { child, std::move(on_exit) };
+        }
+        // epoll_ctl may be called while the reaper sits in epoll_wait.
+        struct epoll_event event = {};
+        event.events = EPOLLIN;
+        event.data.fd = fd;
+        if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) == 0) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(reaper_mutex);
+        on_exit = std::move(pidfd_children[fd].on_exit);
+        pidfd_children.erase(fd);
+        close(fd);
+    }
+#endif
+    {
+        std::lock_guard<std::mutex> lock(reaper_mutex);
+        polled_children[child] = std::move(on_exit);
+    }
+#ifdef __linux__
+    // Wake the reaper, it switches from blocking to polling.
+    std::uint64_t one = 1;
+    if (write(wake_fd, &one, sizeof(one)) == -1) {
+        perror("Could not wake child reaper");
+    }
+#endif
+}
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef CHILD_REAPER_H
+#define CHILD_REAPER_H
+
+#include <functional>
+
+#ifdef _WIN32
+#include <windows.h>
+using ChildHandle = HANDLE;
+#else
+#include <sys/types.h>
+using ChildHandle = pid_t;
+#endif
+
+// Called once when the child has exited and was reaped. `status` is the
+// waitpid() status on POSIX and the process exit code on Windows.
+using ChildExitHandler = std::function<void(int status)>;
+
+// One reaper for all child processes, so threads and memory stay constant no
+// matter how many children are spawned. On Linux a single thread waits on the
+// pidfd of every child with epoll (falling back to polling waitpid(WNOHANG)
+// on kernels without pidfd_open); on Windows the system thread pool waits on
+// the process handles.
+void start_child_reaper();
+void stop_child_reaper();
+
+// Takes ownership of `child`: it is reaped (Windows: closed) by the reaper.
+void watch_child(ChildHandle child, ChildExitHandler on_exit);
+
+#endif
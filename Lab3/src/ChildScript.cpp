@@ -0,0 +1,153 @@
+#include "ChildScript.h"
+#include <fstream>
+#include <sstream>
+
+namespace {
+
+struct OpName {
+    const char* name;
+    ChildOpKind kind;
+};
+
+const OpName OP_NAMES[] = {
+    { "add", ChildOpKind::Add },
+    { "sub", ChildOpKind::Sub },
+    { "mul", ChildOpKind::Mul },
+    { "div", ChildOpKind::Div },
+    { "set", ChildOpKind::Set },
+    { "sleep", ChildOpKind::Sleep },
+};
+
+std::string trim(const std::string& value) {
+    std::size_t begin = value.find_first_not_of(" \t\r");
+    if (begin == std::string::npos) {
+        return "";
+    }
+    std::size_t end = value.find_last_not_of(" \t\r");
+    return value.substr(begin, end - begin + 1);
+}
+
+bool parse_op(const std::string& text, ChildOp& op, std::string& error) {
+    std::istringstream stream(text);
+    std::string name;
+    long long value = 0;
+    std::string rest;
+    if (!(stream >> name >> value) || (stream >> rest)) {
+        error = "expected \"<op> <number>\", got \"" + text + "\"";
+        return false;
+    }
+    if (value < -2147483647LL || value > 2147483647LL) {
+        error = "value out of range in \"" + text + "\"";
+        return false;
+    }
+
+    for (const OpName& known : OP_NAMES) {
+        if (name == known.name) {
+            op = { known.kind, static_cast<int>(value) };
+            if (op.kind == ChildOpKind::Div && op.value == 0) {
+                error = "division by zero";
+                return false;
+            }
+            if (op.kind == ChildOpKind::Sleep && op.value < 0) {
+                error = "negative sleep";
+                return false;
+            }
+            return true;
+        }
+    }
+    error = "unknown operation \"" + name + "\"";
+    return false;
+}
+
+}
+
+std::vector<ChildScript> default_child_scripts() {
+    return {
+        { { ChildOpKind::Add, 10 } },
+        { { ChildOpKind::Mul, 2 }, { ChildOpKind::Sleep, 2000 }, { ChildOpKind::Div, 2 } },
+    };
+}
+
+bool load_child_scripts(const std::string& path, std::vector<ChildScript>& scripts, std::string& error) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        error = "cannot open " + path;
+        return false;
+    }
+
+    scripts.clear();
+    std::string line;
+    int line_number = 0;
+    while (std::getline(file, line)) {
+        ++line_number;
+        line = trim(line);
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+
+        ChildScript script;
+        std::size_t start = 0;
+        while (start <= line.size()) {
+            std::size_t end = line.find(';', start);
+            std::string text = trim(line.substr(start, end == std::string::npos ? std::string::npos : end - start));
+            if (!text.empty()) {
+                ChildOp op;
+                if (!parse_op(text, op, error)) {
+                    error = path + ":" + std::to_string(line_number) + ": " + error;
+                    return false;
+                }
+                script.push_back(op);
+            }
+            if (end == std::string::npos) {
+                break;
+            }
+            start = end + 1;
+        }
+        scripts.push_back(script);
+    }
+
+    if (scripts.empty()) {
+        error = path + ": no child scripts";
+        return false;
+    }
+    return true;
+}
+
+int apply_child_op(const ChildOp& op, int value) {
+    // Wraps around like the counter increments do, instead of overflowing.
+    auto wrap = [](long long result) { return static_cast<int>(static_cast<unsigned int>(result)); };
+    switch (op.kind) {
+    case ChildOpKind::Add:
+        return wrap(static_cast<long long>(value) + op.value);
+    case ChildOpKind::Sub:
+        return wrap(static_cast<long long>(value) - op.value);
+    case ChildOpKind::Mul:
+        return wrap(static_cast<long long>(value) * op.value);
+    case ChildOpKind::Div:
+        return op.value == -1 ? wrap(-static_cast<long long>(value)) : value / op.value;
+    case ChildOpKind::Set:
+        return op.value;
+    case ChildOpKind::Sleep:
+        break;
+    }
+    return value;
+}
+
+std::size_t counter_op_count(const ChildScript& script) {
+    std::size_t count = 0;
+    for (const ChildOp& op : script) {
+        if (op.kind != ChildOpKind::Sleep) {
+            ++count;
+        }
+    }
+    return count;
+}
+
+std::string describe_child_op(const ChildOp& op) {
+    for (const OpName& known : OP_NAMES) {
+        if (known.kind == op.kind) {
+            return std::string(known.name) + " " + std::to_string(op.value);
+        }
+    }
+    return "?";
+}
@@ -0,0 +1,36 @@
+#ifndef CHILD_SCRIPT_H
+#define CHILD_SCRIPT_H
+
+#include <string>
+#include <vector>
+
+enum class ChildOpKind { Add, Sub, Mul, Div, Set, Sleep };
+
+struct ChildOp {
+    ChildOpKind kind;
+    int value; // operand, milliseconds for Sleep
+};
+
+// Operations one copy performs, in order. Copy N (1-based) runs script N.
+using ChildScript = std::vector<ChildOp>;
+
+// The two built-in copies: "add 10" and "mul 2; sleep 2000; div 2".
+std::vector<ChildScript> default_child_scripts();
+
+// Reads one script per line, operations separated by ';':
+//     add 10
+//     mul 2; sleep 2000; div 2
+// Empty lines and lines starting with '#' are skipped. On failure returns
+// false and describes the problem in `error`.
+bool load_child_scripts(const std::string& path, std::vector<ChildScript>& scripts, std::string& error);
+
+// New counter value after a counter operation (Sleep leaves it unchanged).
+int apply_child_op(const ChildOp& op, int value);
+
+// Number of operations that change the counter.
+std::size_t counter_op_count(const ChildScript& script);
+
+// "mul 2" etc., for log messages.
+std::string describe_child_op(const ChildOp& op);
+
+#endif
@@ -0,0 +1,27 @@
+#ifndef CONTROL_PROTOCOL_H
+#define CONTROL_PROTOCOL_H
+
+#include <cstddef>
+
+// Line protocol of the leader's control socket, shared by Timer and timerctl.
+//
+// Every request is one line, every request gets exactly one response line,
+// in order, so a client may pipeline any number of requests:
+//     get           -> ok <counter>
+//     set <value>   -> ok <value>
+//     add <delta>   -> ok <new counter>
+//     stats         -> ok key=value ...
+//     watch         -> ok <counter>, then "changed <counter>" on every change
+//     get <name>          -> ok <value>, err when there is no such counter
+//     set <name> <value>  -> ok <value>, creates the counter
+//     add <name> <delta>  -> ok <new value>, creates the counter at 0
+//     counters            -> ok name=value ...
+// Named counters are 64-bit, see NamedCounters.h for valid names.
+// Errors are answered with "err <message>".
+
+constexpr const char* DEFAULT_CONTROL_SOCKET = "/tmp/timer-control.sock";
+
+// Longest request line accepted, a longer one closes the connection.
+constexpr std::size_t CONTROL_MAX_LINE = 4096;
+
+#endif
@@ -0,0 +1,479 @@
+#include "ControlServer.h"
+#include <iostream>
+
+#ifdef _WIN32
+
+bool start_control_server(const std::string&, ControlHandlers) {
+    std::cerr << "The control socket is not supported on Windows." << std::endl;
+    return false;
+}
+
+void stop_control_server() {
+}
+
+#else
+
+#include <atomic>
+#include <chrono>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+// A client that stops reading is not served further until this much
+// pending output has been sent.
+constexpr std::size_t MAX_PENDING_OUTPUT = 1 << 20;
+
+
+struct Connection {
+    int fd;
+    std::string input;
+    std::string output;
+    bool watching = false;
+    std::uint32_t watched_sequence = 0; // change sequence the watcher was last told about
+    bool closing = false;   // peer finished sending, close once output is flushed
+    std::uint32_t events = 0;
+};
+
+std::string socket_path;
+ControlHandlers handlers;
+int listen_fd = -1;
+int epoll_fd = -1;
+int wake_fd = -1;
+int change_fd = -1;
+std::thread server_thread;
+std::thread watch_thread;
+std::atomic<bool> watch_exited(false);
+std::atomic<bool> server_stop(false);
+std::unordered_map<int, Connection> connections;
+std::size_t watcher_count = 0;
+// Latest counter_sequence seen by the watch thread, read by the epoll thread.
+std::atomic<std::uint32_t> change_sequence(0);
+
+bool parse_int(const std::string& text, int& value) {
+    if (text.empty()) {
+        return false;
+    }
+    char* end = nullptr;
+    errno = 0;
+    long result = std::strtol(text.c_str(), &end, 10);
+    if (errno != 0 || *end != '\0' || result < INT32_MIN || result > INT32_MAX) {
+        return false;
+    }
+    value = static_cast<int>(result);
+    return true;
+}
+
+bool parse_int64(const std::string& text, std::int64_t& value) {
+    if (text.empty()) {
+        return false;
+    }
+    char* end = nullptr;
+    errno = 0;
+    long long result = std::strtoll(text.c_str(), &end, 10);
+    if (errno != 0 || *end != '\0') {
+        return false;
+    }
+    value = result;
+    return true;
+}
+
+// "get|set|add <name> [number]". Returns false when `argument` does not start
+// with a counter name, so the request is one for the main counter.
+bool handle_named_request(Connection& connection, const std::string& command, const std::string& argument) {
+    std::size_t space = argument.find(' ');
+    std::string name = argument.substr(0, space);
+    if (name.empty() || !((name[0] >= 'a' && name[0] <= 'z') || (name[0] >= 'A' && name[0] <= 'Z') || name[0] == '_')) {
+        return false;
+    }
+    std::string number;
+    if (space != std::string::npos && argument.find_first_not_of(' ', space) != std::string::npos) {
+        number = argument.substr(argument.find_first_not_of(' ', space));
+    }
+
+    std::int64_t value = 0;
+    if (command == "get" && number.empty()) {
+        if (handlers.get_named(name, value)) {
+            connection.output += "ok " + std::to_string(value) + "\n";
+        } else {
+            connection.output += "err no counter: " + name + "\n";
+        }
+    } else if ((command == "set" || command == "add") && parse_int64(number, value)) {
+        bool stored = command == "set" ? handlers.set_named(name, value) : handlers.add_named(name, value, value);
+        if (stored) {
+            connection.output += "ok " + std::to_string(value) + "\n";
+        } else {
+            connection.output += "err invalid counter name or no free slot: " + name + "\n";
+        }
+    } else {
+        connection.output += "err expected: " + command + (command == "get" ? " <name>" : " <name> <integer>") + "\n";
+    }
+    return true;
+}
+
+void handle_request(Connection& connection, const std::string& line) {
+    std::size_t space = line.find(' ');
+    std::string command = line.substr(0, space);
+    std::string argument;
+    if (space != std::string::npos && line.find_first_not_of(' ', space) != std::string::npos) {
+        argument = line.substr(line.find_first_not_of(' ', space));
+    }
+
+    int value = 0;
+    if ((command == "get" || command == "set" || command == "add") && handle_named_request(connection, command, argument)) {
+        return;
+    }
+    if (command == "get" && argument.empty()) {
+        connection.output += "ok " + std::to_string(handlers.get()) + "\n";
+    } else if (command == "set" && parse_int(argument, value)) {
+        connection.output += "ok " + std::to_string(handlers.set(value)) + "\n";
+    } else if (command == "add" && parse_int(argument, value)) {
+        connection.output += "ok " + std::to_string(handlers.add(value)) + "\n";
+    } else if (command == "stats" && argument.empty()) {
+        connection.output += "ok " + handlers.stats() + "\n";
+    } else if (command == "counters" && argument.empty()) {
+        connection.output += "ok " + handlers.list_named() + "\n";
+    } else if (command == "watch" && argument.empty()) {
+        if (!connection.watching) {
+            connection.watching = true;
+            ++watcher_count;
+        }
+        // Sequence first: a change after it is reported even if the value read
+        // below already includes it.
+        connection.watched_sequence = change_sequence.load(std::memory_order_acquire);
+        connection.output += "ok " + std::to_string(handlers.get()) + "\n";
+    } else if (command == "set" || command == "add") {
+        connection.output += "err expected an integer: " + line + "\n";
+    } else {
+        connection.output += "err unknown command: " + line + "\n";
+    }
+}
+
+void update_events(Connection& connection) {
+    std::uint32_t events = 0;
+    if (!connection.closing && connection.output.size() < MAX_PENDING_OUTPUT) {
+        events |= EPOLLIN;
+    }
+    if (!connection.output.empty()) {
+        events |= EPOLLOUT;
+    }
+    if (events != connection.events) {
+        struct epoll_event event = {};
+        event.events = events;
+        event.data.fd = connection.fd;
+        epoll_ctl(epoll_fd, EPOLL_CTL_MOD, connection.fd, &event);
+        connection.events = events;
+    }
+}
+
+void close_connection(int fd) {
+    auto it = connections.find(fd);
+    if (it == connections.end()) {
+        return;
+    }
+    if (it->second.watching) {
+        --watcher_count;
+    }
+    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+    close(fd);
+    connections.erase(it);
+}
+
+// Returns false when the connection is gone.
+bool flush_output(Connection& connection) {
+    while (!connection.output.empty()) {
+        ssize_t written = send(connection.fd, connection.output.data(), connection.output.size(), MSG_NOSIGNAL);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                break;
+            }
+            close_connection(connection.fd);
+            return false;
+        }
+        connection.output.erase(0, static_cast<std::size_t>(written));
+    }
+    if (connection.closing && connection.output.empty()) {
+        close_connection(connection.fd);
+        return false;
+    }
+    update_events(connection);
+    return true;
+}
+
+void read_requests(Connection& connection) {
+    char buffer[64 * 1024];
+    while (connection.output.size() < MAX_PENDING_OUTPUT) {
+        ssize_t count = recv(connection.fd, buffer, sizeof(buffer), 0);
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                connection.closing = true;
+            }
+            break;
+        }
+        if (count == 0) {
+            connection.closing = true;
+            break;
+        }
+        connection.input.append(buffer, static_cast<std::size_t>(count));
+
+        std::size_t start = 0;
+        std::size_t end;
+        while ((end = connection.input.find('\n', start)) != std::string::npos) {
+            std::size_t length = end - start;
+            if (length > 0 && connection.input[end - 1] == '\r') {
+                --length;
+            }
+            handle_request(connection, connection.input.substr(start, length));
+            start = end + 1;
+        }
+        connection.input.erase(0, start);
+        if (connection.input.size() > CONTROL_MAX_LINE) {
+            connection.output += "err request line too long\n";
+            connection.input.clear();
+            connection.closing = true;
+            break;
+        }
+    }
+}
+
+void accept_connections() {
+    while (true) {
+        int fd = accept4(listen_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                perror("Control socket accept failed");
+            }
+            return;
+        }
+        Connection& connection = connections[fd];
+        connection.fd = fd;
+        connection.events = EPOLLIN;
+        struct epoll_event event = {};
+        event.events = EPOLLIN;
+        event.data.fd = fd;
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event);
+    }
+}
+
+// Removes the socket file at `address` if it was left by a leader that
+// died, i.e. it is a socket and nobody accepts connections on it. A live
+// socket, and anything that is not a socket, is kept. Leaves errno at
+// EADDRINUSE when it returns false.
+bool remove_stale_socket(const struct sockaddr_un& address) {
+    struct stat st;
+    if (lstat(address.sun_path, &st) == 0 && !S_ISSOCK(st.st_mode)) {
+        std::cerr << "Control socket path " << address.sun_path << " exists and is not a socket" << std::endl;
+        errno = EADDRINUSE;
+        return false;
+    }
+    int probe = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (probe == -1) {
+        errno = EADDRINUSE;
+        return false;
+    }
+    int connected = connect(probe, reinterpret_cast<const struct sockaddr*>(&address), sizeof(address));
+    int error = errno;
+    close(probe);
+    if (connected == 0) {
+        std::cerr << "Control socket " << address.sun_path << " is served by another process" << std::endl;
+    } else if (error == ECONNREFUSED && (unlink(address.sun_path) == 0 || errno == ENOENT)) {
+        return true;
+    }
+    errno = EADDRINUSE;
+    return false;
+}
+
+// Reports the current value to every watcher that has not seen the latest
+// change. Sequences are compared rather than values, so a change that ends
+// at the value the watcher already has (A -> B -> A) is still reported.
+void notify_watchers() {
+    std::uint32_t sequence = change_sequence.load(std::memory_order_acquire);
+    int value = handlers.get();
+    std::vector<int> fds;
+    for (auto& entry : connections) {
+        Connection& connection = entry.second;
+        if (connection.watching && connection.watched_sequence != sequence) {
+            connection.watched_sequence = sequence;
+            connection.output += "changed " + std::to_string(value) + "\n";
+            fds.push_back(entry.first);
+        }
+    }
+    for (int fd : fds) {
+        auto it = connections.find(fd);
+        if (it != connections.end()) {
+            flush_output(it->second);
+        }
+    }
+}
+
+void server_loop() {
+    struct epoll_event events[64];
+    while (!server_stop.load(std::memory_order_acquire)) {
+        int count = epoll_wait(epoll_fd, events, 64, -1);
+        if (count == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("Control socket epoll_wait failed");
+            return;
+        }
+
+        for (int i = 0; i < count; ++i) {
+            int fd = events[i].data.fd;
+            if (fd == wake_fd) {
+                continue;
+            }
+            if (fd == change_fd) {
+                std::uint64_t changes;
+                if (read(change_fd, &changes, sizeof(changes)) > 0 && watcher_count > 0) {
+                    notify_watchers();
+                }
+                continue;
+            }
+            if (fd == listen_fd) {
+                accept_connections();
+                continue;
+            }
+            auto it = connections.find(fd);
+            if (it == connections.end()) {
+                continue;
+            }
+            Connection& connection = it->second;
+            if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+                connection.closing = true;
+            }
+            if (events[i].events & EPOLLIN) {
+                read_requests(connection);
+            }
+            flush_output(connection);
+        }
+    }
+}
+
+// Turns counter changes into change_fd events for the epoll thread.
+void watch_loop() {
+    std::uint32_t sequence = 0;
+    while (!server_stop.load(std::memory_order_acquire)) {
+        std::uint32_t next = handlers.wait_for_change(sequence);
+        if (next != sequence) {
+            sequence = next;
+            change_sequence.store(sequence, std::memory_order_release);
+            std::uint64_t one = 1;
+            if (write(change_fd, &one, sizeof(one)) == -1 && errno != EAGAIN) {
+                perror("Control server change notification failed");
+            }
+        }
+    }
+    watch_exited = true;
+}
+
+}
+
+bool start_control_server(const std::string& path, ControlHandlers control_handlers) {
+    if (server_thread.joinable()) {
+        return true;
+    }
+
+    struct sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) {
+        std::cerr << "Control socket path is too long: " << path << std::endl;
+        return false;
+    }
+    std::strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+
+    listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listen_fd == -1) {
+        perror("Could not create control socket");
+        return false;
+    }
+    int bound = bind(listen_fd, reinterpret_cast<struct sockaddr*>(&address), sizeof(address));
+    if (bound == -1 && errno == EADDRINUSE && remove_stale_socket(address)) {
+        bound = bind(listen_fd, reinterpret_cast<struct sockaddr*>(&address), sizeof(address));
+    }
+    // The socket accepts set/add from anybody who can connect: owner only.
+    // Nobody can connect before listen(), so the mode is right before the
+    // first client gets in.
+    if (bound == -1 || chmod(path.c_str(), S_IRUSR | S_IWUSR) == -1 || listen(listen_fd, SOMAXCONN) == -1) {
+        perror("Could not bind control socket");
+        close(listen_fd);
+        listen_fd = -1;
+        return false;
+    }
+
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    wake_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    change_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (epoll_fd == -1 || wake_fd == -1 || change_fd == -1) {
+        perror("Could not create control server");
+        exit(1);
+    }
+    struct epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.fd = listen_fd;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, listen_fd, &event);
+    event.data.fd = wake_fd;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, wake_fd, &event);
+    event.data.fd = change_fd;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, change_fd, &event);
+
+    socket_path = path;
+    handlers = std::move(control_handlers);
+    server_stop = false;
+    watch_exited = false;
+    server_thread = std::thread(server_loop);
+    watch_thread = std::thread(watch_loop);
+    return true;
+}
+
+void stop_control_server() {
+    if (!server_thread.joinable()) {
+        return;
+    }
+    server_stop.store(true, std::memory_order_release);
+    std::uint64_t one = 1;
+    if (write(wake_fd, &one, sizeof(one)) == -1) {
+        perror("Could not stop control server");
+    }
+    server_thread.join();
+    // A wake that comes just before the watcher starts waiting is lost, so repeat it.
+    while (!watch_exited) {
+        handlers.wake_change_waiters();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    watch_thread.join();
+
+    while (!connections.empty()) {
+        close_connection(connections.begin()->first);
+    }
+    watcher_count = 0;
+    close(listen_fd);
+    close(wake_fd);
+    close(change_fd);
+    close(epoll_fd);
+    listen_fd = wake_fd = change_fd = epoll_fd = -1;
+    unlink(socket_path.c_str());
+}
+
+#endif
@@ -0,0 +1,40 @@
+#ifndef CONTROL_SERVER_H
+#define CONTROL_SERVER_H
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include "ControlProtocol.h"
+
+// What the control server can do with the instance state.
+struct ControlHandlers {
+    std::function<int()> get;
+    std::function<int(int)> set;    // returns the stored value
+    std::function<int(int)> add;    // returns the new value
+    std::function<std::string()> stats;
+
+    // Named counters. Getting an absent counter returns false; setting and
+    // adding return false for an invalid name or a full table.
+    std::function<bool(const std::string& name, std::int64_t& value)> get_named;
+    std::function<bool(const std::string& name, std::int64_t value)> set_named;
+    std::function<bool(const std::string& name, std::int64_t delta, std::int64_t& value)> add_named;
+    std::function<std::string()> list_named;
+
+    // Blocks until the counter may have changed since `sequence` and returns
+    // the new sequence; wake_change_waiters() makes it return early.
+    std::function<std::uint32_t(std::uint32_t sequence)> wait_for_change;
+    std::function<void()> wake_change_waiters;
+};
+
+// Serves the protocol from ControlProtocol.h on a Unix domain socket, all
+// connections on one epoll thread. Requests that arrive together are
+// answered with one write. A second thread sleeps in wait_for_change() and
+// signals the epoll thread to notify watchers. Only the leader runs the server; a stale socket
+// file left by a crashed leader (nothing accepts on it) is replaced, a live
+// one is not. The socket is accessible to its owner only.
+bool start_control_server(const std::string& path, ControlHandlers handlers);
+
+// Closes all connections and removes the socket file.
+void stop_control_server();
+
+#endif
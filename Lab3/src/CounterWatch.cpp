@@ -0,0 +1,82 @@
+#include "CounterWatch.h"
+#include <climits>
+#include <thread>
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <ctime>
+#endif
+
+namespace {
+
+#ifdef __linux__
+// Not FUTEX_PRIVATE_FLAG: waiters and writers are different processes.
+void futex_wait(std::atomic<std::uint32_t>* word, std::uint32_t expected, std::chrono::nanoseconds timeout) {
+    struct timespec ts;
+    ts.tv_sec = static_cast<time_t>(timeout.count() / 1000000000);
+    ts.tv_nsec = static_cast<long>(timeout.count() % 1000000000);
+    syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(word), FUTEX_WAIT, expected, &ts, nullptr, 0);
+}
+
+void futex_wake_all(std::atomic<std::uint32_t>* word) {
+    syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(word), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+}
+#else
+const auto POLL_INTERVAL = std::chrono::milliseconds(1);
+#endif
+
+}
+
+std::uint32_t counter_change_sequence(const SharedSegment* segment) {
+    return segment->counter_sequence.load(std::memory_order_acquire);
+}
+
+void publish_counter_change(SharedSegment* segment) {
+    // Pairs with the waiter's increment of counter_waiters: either the waiter
+    // sees the new sequence, or this sees the waiter and wakes it.
+    segment->counter_sequence.fetch_add(1, std::memory_order_seq_cst);
+#ifdef __linux__
+    if (segment->counter_waiters.load(std::memory_order_seq_cst) != 0) {
+        futex_wake_all(&segment->counter_sequence);
+    }
+#endif
+}
+
+void wake_change_waiters(SharedSegment* segment) {
+#ifdef __linux__
+    futex_wake_all(&segment->counter_sequence);
+#else
+    (void)segment;
+#endif
+}
+
+std::uint32_t wait_for_change(SharedSegment* segment, std::uint32_t last_sequence,
+                              std::chrono::milliseconds timeout, std::chrono::milliseconds coalesce) {
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    std::uint32_t sequence = segment->counter_sequence.load(std::memory_order_acquire);
+
+#ifdef __linux__
+    if (sequence == last_sequence) {
+        auto remaining = deadline - std::chrono::steady_clock::now();
+        if (remaining > std::chrono::nanoseconds(0)) {
+            segment->counter_waiters.fetch_add(1, std::memory_order_seq_cst);
+            futex_wait(&segment->counter_sequence, last_sequence, remaining);
+            segment->counter_waiters.fetch_sub(1, std::memory_order_seq_cst);
+        }
+        sequence = segment->counter_sequence.load(std::memory_order_acquire);
+    }
+#else
+    while (sequence == last_sequence && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(POLL_INTERVAL);
+        sequence = segment->counter_sequence.load(std::memory_order_acquire);
+    }
+#endif
+
+    if (sequence != last_sequence && coalesce.count() > 0) {
+        std::this_thread::sleep_for(coalesce);
+        sequence = segment->counter_sequence.load(std::memory_order_acquire);
+    }
+    return sequence;
+}
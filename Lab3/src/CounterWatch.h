@@ -0,0 +1,31 @@
+#ifndef COUNTER_WATCH_H
+#define COUNTER_WATCH_H
+
+#include <chrono>
+#include <cstdint>
+#include "SharedSegment.h"
+
+// Change notification for the shared counter. Every mutation bumps
+// SharedSegment::counter_sequence; watchers block on that word with a futex
+// (shared between processes), so an idle watcher costs nothing and a writer
+// only makes a syscall when someone is actually waiting. Other platforms
+// fall back to polling the sequence.
+
+// Current sequence, pass it to wait_for_change() as the last seen value.
+std::uint32_t counter_change_sequence(const SharedSegment* segment);
+
+// Called by every counter writer after the new value is stored.
+void publish_counter_change(SharedSegment* segment);
+
+// Blocks until the sequence differs from `last_sequence` or `timeout`
+// passes, and returns the sequence. With a `coalesce` window it then waits
+// that much longer, so a burst of changes wakes the caller once. May also
+// return the unchanged sequence early after wake_change_waiters().
+std::uint32_t wait_for_change(SharedSegment* segment, std::uint32_t last_sequence,
+                              std::chrono::milliseconds timeout,
+                              std::chrono::milliseconds coalesce = std::chrono::milliseconds(0));
+
+// Wakes every waiter without a change, e.g. so a watcher thread can stop.
+void wake_change_waiters(SharedSegment* segment);
+
+#endif
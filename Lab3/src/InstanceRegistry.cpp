@@ -0,0 +1,84 @@
+#include "InstanceRegistry.h"
+#include <new>
+#include "TimestampFormatter.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <signal.h>
+#include <cerrno>
+#endif
+
+namespace {
+
+void reset_slot(InstanceSlot* slot, InstanceRole role) {
+    std::int64_t now = TimestampFormatter::now_ns();
+    slot->role.store(role, std::memory_order_relaxed);
+    slot->started_at_ns.store(now, std::memory_order_relaxed);
+    slot->heartbeat_ns.store(now, std::memory_order_relaxed);
+    slot->ops.store(0, std::memory_order_relaxed);
+    slot->log_lines.store(0, std::memory_order_relaxed);
+    slot->children_spawned.store(0, std::memory_order_relaxed);
+}
+
+}
+
+bool process_alive(std::uint32_t pid) {
+#ifdef _WIN32
+    HANDLE process = OpenProcess(SYNCHRONIZE, FALSE, pid);
+    if (process == NULL) {
+        return GetLastError() != ERROR_INVALID_PARAMETER;
+    }
+    bool alive = WaitForSingleObject(process, 0) == WAIT_TIMEOUT;
+    CloseHandle(process);
+    return alive;
+#else
+    return kill(static_cast<pid_t>(pid), 0) == 0 || errno != ESRCH;
+#endif
+}
+
+void init_instance_registry(InstanceRegistry* registry) {
+    for (InstanceSlot& slot : registry->slots) {
+        new (&slot.pid) std::atomic<std::uint32_t>(0);
+        new (&slot.role) std::atomic<std::uint32_t>(0);
+        new (&slot.started_at_ns) std::atomic<std::int64_t>(0);
+        new (&slot.heartbeat_ns) std::atomic<std::int64_t>(0);
+        new (&slot.ops) std::atomic<std::uint64_t>(0);
+        new (&slot.log_lines) std::atomic<std::uint64_t>(0);
+        new (&slot.children_spawned) std::atomic<std::uint64_t>(0);
+    }
+}
+
+InstanceSlot* claim_instance_slot(InstanceRegistry* registry, std::uint32_t pid, InstanceRole role) {
+    for (InstanceSlot& slot : registry->slots) {
+        std::uint32_t expected = 0;
+        if (slot.pid.compare_exchange_strong(expected, pid, std::memory_order_acq_rel)) {
+            reset_slot(&slot, role);
+            return &slot;
+        }
+    }
+
+    // No free slot: take over one whose owner died without releasing it. The
+    // CAS on the old PID makes sure only one instance reclaims it.
+    for (InstanceSlot& slot : registry->slots) {
+        std::uint32_t owner = slot.pid.load(std::memory_order_acquire);
+        if (owner != 0 && !process_alive(owner) &&
+            slot.pid.compare_exchange_strong(owner, pid, std::memory_order_acq_rel)) {
+            reset_slot(&slot, role);
+            return &slot;
+        }
+    }
+    return nullptr;
+}
+
+void release_instance_slot(InstanceSlot* slot) {
+    if (slot) {
+        slot->pid.store(0, std::memory_order_release);
+    }
+}
+
+void instance_heartbeat(InstanceSlot* slot) {
+    if (slot) {
+        slot->heartbeat_ns.store(TimestampFormatter::now_ns(), std::memory_order_relaxed);
+    }
+}
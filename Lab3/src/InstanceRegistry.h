@@ -0,0 +1,47 @@
+#ifndef INSTANCE_REGISTRY_H
+#define INSTANCE_REGISTRY_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include "CacheLine.h"
+
+constexpr std::size_t REGISTRY_SLOTS = 64;
+
+enum InstanceRole : std::uint32_t {
+    ROLE_ADDITIONAL = 1,
+    ROLE_LEADER = 2,
+};
+
+// One running instance. A slot is free while `pid` is 0 and is written only
+// by the instance that owns it, so every instance updates its own cache line.
+struct alignas(CACHE_LINE_SIZE) InstanceSlot {
+    std::atomic<std::uint32_t> pid;
+    std::atomic<std::uint32_t> role;
+    std::atomic<std::int64_t> started_at_ns;    // wall clock
+    std::atomic<std::int64_t> heartbeat_ns;     // wall clock, refreshed every second
+    std::atomic<std::uint64_t> ops;             // counter changes made by the instance
+    std::atomic<std::uint64_t> log_lines;
+    std::atomic<std::uint64_t> children_spawned;
+};
+
+// Fixed table of running instances in the shared segment. Monitors read it
+// directly (timerctl top), without asking any instance.
+struct InstanceRegistry {
+    InstanceSlot slots[REGISTRY_SLOTS];
+};
+
+void init_instance_registry(InstanceRegistry* registry);
+
+// Claims a free slot, or the slot of an instance that died without
+// releasing it. Returns nullptr when all slots belong to live processes.
+InstanceSlot* claim_instance_slot(InstanceRegistry* registry, std::uint32_t pid, InstanceRole role);
+
+void release_instance_slot(InstanceSlot* slot);
+
+void instance_heartbeat(InstanceSlot* slot);
+
+// False only when the process is known to be gone.
+bool process_alive(std::uint32_t pid);
+
+#endif
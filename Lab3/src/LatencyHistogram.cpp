@@ -0,0 +1,108 @@
+#include "LatencyHistogram.h"
+#include <iomanip>
+
+LatencyHistogram::LatencyHistogram() {
+    reset();
+}
+
+std::size_t LatencyHistogram::bucket_index(std::uint64_t value) {
+    if (value < 2 * SUB_BUCKETS) {
+        return static_cast<std::size_t>(value);
+    }
+    int msb = 63;
+    while (!(value >> msb)) {
+        --msb;
+    }
+    if (msb >= MAX_VALUE_BITS) {
+        return BUCKET_COUNT - 1;
+    }
+    int shift = msb - SUB_BUCKET_BITS;
+    return static_cast<std::size_t>(shift + 1) * SUB_BUCKETS + ((value >> shift) - SUB_BUCKETS);
+}
+
+std::int64_t LatencyHistogram::bucket_value(std::size_t index) {
+    if (index < 2 * SUB_BUCKETS) {
+        return static_cast<std::int64_t>(index);
+    }
+    std::size_t shift = index / SUB_BUCKETS - 1;
+    std::uint64_t sub = index % SUB_BUCKETS + SUB_BUCKETS;
+    return static_cast<std::int64_t>(sub << shift);
+}
+
+void LatencyHistogram::record(std::int64_t value_ns) {
+    if (value_ns < 0) {
+        value_ns = 0;
+    }
+    counts_[bucket_index(static_cast<std::uint64_t>(value_ns))].fetch_add(1, std::memory_order_relaxed);
+    total_count_.fetch_add(1, std::memory_order_relaxed);
+    total_sum_.fetch_add(static_cast<std::uint64_t>(value_ns), std::memory_order_relaxed);
+    std::int64_t current = max_.load(std::memory_order_relaxed);
+    while (value_ns > current && !max_.compare_exchange_weak(current, value_ns, std::memory_order_relaxed)) {
+    }
+}
+
+void LatencyHistogram::reset() {
+    for (auto& count : counts_) {
+        count.store(0, std::memory_order_relaxed);
+    }
+    total_count_.store(0, std::memory_order_relaxed);
+    total_sum_.store(0, std::memory_order_relaxed);
+    max_.store(0, std::memory_order_relaxed);
+}
+
+std::uint64_t LatencyHistogram::count() const {
+    return total_count_.load(std::memory_order_relaxed);
+}
+
+std::int64_t LatencyHistogram::max() const {
+    return max_.load(std::memory_order_relaxed);
+}
+
+std::int64_t LatencyHistogram::mean() const {
+    std::uint64_t count = total_count_.load(std::memory_order_relaxed);
+    return count > 0 ? static_cast<std::int64_t>(total_sum_.load(std::memory_order_relaxed) / count) : 0;
+}
+
+std::int64_t LatencyHistogram::value_at_percentile(double percentile) const {
+    std::uint64_t total = 0;
+    for (const auto& count : counts_) {
+        total += count.load(std::memory_order_relaxed);
+    }
+    if (total == 0) {
+        return 0;
+    }
+    auto wanted = static_cast<std::uint64_t>(percentile / 100.0 * static_cast<double>(total) + 0.5);
+    if (wanted == 0) {
+        wanted = 1;
+    }
+    std::uint64_t seen = 0;
+    for (std::size_t i = 0; i < BUCKET_COUNT; ++i) {
+        seen += counts_[i].load(std::memory_order_relaxed);
+        if (seen >= wanted) {
+            return bucket_value(i);
+        }
+    }
+    return max();
+}
+
+void LatencyHistogram::merge(const LatencyHistogram& other) {
+    for (std::size_t i = 0; i < BUCKET_COUNT; ++i) {
+        counts_[i].fetch_add(other.counts_[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+    total_count_.fetch_add(other.count(), std::memory_order_relaxed);
+    total_sum_.fetch_add(other.total_sum_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    std::int64_t other_max = other.max();
+    std::int64_t current = max_.load(std::memory_order_relaxed);
+    while (other_max > current && !max_.compare_exchange_weak(current, other_max, std::memory_order_relaxed)) {
+    }
+}
+
+void LatencyHistogram::print(std::ostream& out, const char* title) const {
+    static const double PERCENTILES[] = { 50, 90, 99, 99.9, 99.99, 100 };
+
+    out << title << ": count " << count() << ", mean " << mean() / 1000.0 << " us, max " << max() / 1000.0 << " us\n";
+    for (double percentile : PERCENTILES) {
+        out << "  p" << std::left << std::setw(6) << percentile << std::right << std::setw(12)
+            << (percentile >= 100 ? max() : value_at_percentile(percentile)) / 1000.0 << " us\n";
+    }
+}
@@ -0,0 +1,48 @@
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+
+// Log-linear histogram of non-negative nanosecond values in the spirit of
+// HdrHistogram: every power of two is split into SUB_BUCKETS linear buckets,
+// so any recorded value is reported within 1/SUB_BUCKETS (about 3%).
+// Recording is lock-free and allocation-free; readers may run concurrently.
+class LatencyHistogram {
+public:
+    static constexpr int SUB_BUCKET_BITS = 5;
+    static constexpr std::uint64_t SUB_BUCKETS = 1u << SUB_BUCKET_BITS;
+    static constexpr int MAX_VALUE_BITS = 40; // ~18 minutes in ns, larger values are clamped
+    static constexpr std::size_t BUCKET_COUNT = (MAX_VALUE_BITS - SUB_BUCKET_BITS + 2) * SUB_BUCKETS;
+
+    LatencyHistogram();
+
+    void record(std::int64_t value_ns);
+    void reset();
+
+    std::uint64_t count() const;
+    std::int64_t max() const;
+    std::int64_t mean() const;
+
+    // Smallest recorded bucket value such that `percentile` percent of the
+    // recorded values are at or below it.
+    std::int64_t value_at_percentile(double percentile) const;
+
+    // Adds the counts of `other` to this histogram.
+    void merge(const LatencyHistogram& other);
+
+    // Summary line followed by a percentile table.
+    void print(std::ostream& out, const char* title) const;
+
+private:
+    static std::size_t bucket_index(std::uint64_t value);
+    static std::int64_t bucket_value(std::size_t index);
+
+    std::atomic<std::uint64_t> counts_[BUCKET_COUNT];
+    std::atomic<std::uint64_t> total_count_;
+    std::atomic<std::uint64_t> total_sum_;
+    std::atomic<std::int64_t> max_;
+};
+
+#endif
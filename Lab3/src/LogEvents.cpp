@@ -0,0 +1,71 @@
+#include "LogEvents.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+namespace {
+
+struct EventInfo {
+    const char* name;
+    // %v - payload, %p - pid, %s - text
+    const char* format;
+};
+
+const EventInfo EVENTS[EVENT_COUNT] = {
+    { "text", "%s" },
+    { "clock_anchor", "Clock anchor: %v" },
+    { "program_started", "Program started. PID: %p" },
+    { "counter_value", "Main instance log: Counter value: %v" },
+    { "counter_set", "Counter set to: %v" },
+    { "spawn_started", "Spawning child processes." },
+    { "spawn_skipped", "Child processes still running. Skipping spawn." },
+    { "child_started", "Child process %v started. PID: %p" },
+    { "child_exiting", "Child process %v exiting. PID: %p" },
+    { "child_op", "Child %s, counter: %v. PID: %p" },
+};
+
+}
+
+const char* log_event_name(std::uint16_t event) {
+    return event < EVENT_COUNT ? EVENTS[event].name : nullptr;
+}
+
+std::uint16_t log_event_by_name(const char* name) {
+    for (std::uint16_t event = 0; event < EVENT_COUNT; ++event) {
+        if (std::strcmp(EVENTS[event].name, name) == 0) {
+            return event;
+        }
+    }
+    return EVENT_COUNT;
+}
+
+std::size_t render_log_event(std::uint16_t event, std::int64_t payload, std::uint32_t pid,
+                             const char* text, std::size_t text_length, char* out, std::size_t capacity) {
+    if (event >= EVENT_COUNT) {
+        int length = snprintf(out, capacity, "Unknown event %u: %lld", static_cast<unsigned>(event),
+                              static_cast<long long>(payload));
+        return length < 0 ? 0 : std::min(static_cast<std::size_t>(length), capacity - 1);
+    }
+
+    std::size_t length = 0;
+    for (const char* f = EVENTS[event].format; *f && length < capacity; ++f) {
+        if (*f != '%' || f[1] == '\0') {
+            out[length++] = *f;
+            continue;
+        }
+        ++f;
+        if (*f == 's') {
+            std::size_t count = std::min(text_length, capacity - length);
+            std::memcpy(out + length, text, count);
+            length += count;
+        } else {
+            char number[24];
+            int count = *f == 'p' ? snprintf(number, sizeof(number), "%u", pid)
+                                  : snprintf(number, sizeof(number), "%lld", static_cast<long long>(payload));
+            std::size_t copied = std::min(static_cast<std::size_t>(count), capacity - length);
+            std::memcpy(out + length, number, copied);
+            length += copied;
+        }
+    }
+    return length;
+}
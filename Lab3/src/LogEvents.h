@@ -0,0 +1,34 @@
+#ifndef LOG_EVENTS_H
+#define LOG_EVENTS_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Identifiers of structured log records. Values are stored in binary logs,
+// so existing ids must never change; new events are appended before EVENT_COUNT.
+enum LogEvent : std::uint16_t {
+    EVENT_TEXT = 0,          // free-form text
+    EVENT_CLOCK_ANCHOR,      // payload: wall clock ns - monotonic ns
+    EVENT_PROGRAM_STARTED,
+    EVENT_COUNTER_VALUE,     // payload: counter
+    EVENT_COUNTER_SET,       // payload: new value
+    EVENT_SPAWN_STARTED,
+    EVENT_SPAWN_SKIPPED,
+    EVENT_CHILD_STARTED,     // payload: child id
+    EVENT_CHILD_EXITING,     // payload: child id
+    EVENT_CHILD_OP,          // payload: counter after the operation, text: operation
+    EVENT_COUNT
+};
+
+// Short name used for filtering ("counter_value"), nullptr for unknown ids.
+const char* log_event_name(std::uint16_t event);
+
+// Looks an event up by its short name, returns EVENT_COUNT if there is none.
+std::uint16_t log_event_by_name(const char* name);
+
+// Renders the message part of a log line (without timestamp) into `out`.
+// Returns the number of characters written, at most `capacity`.
+std::size_t render_log_event(std::uint16_t event, std::int64_t payload, std::uint32_t pid,
+                             const char* text, std::size_t text_length, char* out, std::size_t capacity);
+
+#endif
@@ -0,0 +1,169 @@
+#include "LogRing.h"
+#include <chrono>
+#include <cstring>
+#include "InstanceRegistry.h"
+
+#ifndef _WIN32
+#include <time.h>
+#endif
+
+namespace {
+
+constexpr std::uint64_t RING_MASK = LOG_RING_SLOTS - 1;
+
+// A slot that stays claimed but unpublished for this long is checked for a
+// producer that died between claiming and publishing it.
+const auto ABANDON_TIMEOUT = std::chrono::seconds(1);
+
+// Claiming and publishing are a few hundred nanoseconds apart. A slot held
+// this long is given up even when its pid looks alive: the pid may have been
+// reused by another process after the writer died, and waiting for it would
+// fill the ring and drop every record from then on. Only a writer stopped
+// for longer than this (e.g. in a debugger) can still scribble on the slot.
+const auto ABANDON_LIMIT = std::chrono::seconds(30);
+
+// Moves enqueue_pos past `pos` once its slot is claimed. Any producer may do
+// it, so a claimer that stops right after its claim does not block the rest.
+void advance_enqueue(LogRing* ring, std::uint64_t pos) {
+    ring->enqueue_pos.compare_exchange_strong(pos, pos + 1, std::memory_order_relaxed);
+}
+
+// True when `sequence` is a claim of the lap `pos` belongs to.
+bool claimed_in_lap(std::uint64_t sequence, std::uint64_t pos) {
+    return (sequence & LOG_CLAIM_BIT) != 0 && sequence >> 32 == log_claim_token(pos, 0) >> 32;
+}
+
+std::uint32_t process_id = 0;
+
+}
+
+std::int64_t monotonic_ns() {
+#ifdef _WIN32
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<std::int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+#endif
+}
+
+void set_log_process_id(std::uint32_t pid) {
+    process_id = pid;
+}
+
+void init_log_ring(LogRing* ring) {
+    ring->enqueue_pos.store(0, std::memory_order_relaxed);
+    ring->dequeue_pos.store(0, std::memory_order_relaxed);
+    ring->dropped.store(0, std::memory_order_relaxed);
+    ring->abandoned.store(0, std::memory_order_relaxed);
+    for (std::uint64_t i = 0; i < LOG_RING_SLOTS; ++i) {
+        ring->records[i].sequence.store(i, std::memory_order_relaxed);
+    }
+}
+
+bool log_ring_push(LogRing* ring, LogEvent event, std::int64_t payload, const char* text, std::size_t length) {
+    std::uint64_t pos = ring->enqueue_pos.load(std::memory_order_relaxed);
+    LogRecord* record;
+    while (true) {
+        record = &ring->records[pos & RING_MASK];
+        std::uint64_t sequence = record->sequence.load(std::memory_order_acquire);
+        if (sequence == pos) {
+            // The claim and the owner are one store, there is no moment when
+            // the slot is taken by nobody known.
+            if (record->sequence.compare_exchange_weak(sequence, log_claim_token(pos, process_id),
+                                                       std::memory_order_acquire)) {
+                advance_enqueue(ring, pos);
+                break;
+            }
+            continue;
+        }
+        if (sequence == pos + 1 || claimed_in_lap(sequence, pos)) {
+            // Taken in this lap by a producer that has not moved enqueue_pos yet.
+            advance_enqueue(ring, pos);
+            pos = ring->enqueue_pos.load(std::memory_order_relaxed);
+            continue;
+        }
+        std::uint64_t current = ring->enqueue_pos.load(std::memory_order_relaxed);
+        if (current != pos) {
+            pos = current;
+            continue;
+        }
+        // The slot still holds the previous lap.
+        ring->dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    if (length > LOG_TEXT_CAPACITY) {
+        length = LOG_TEXT_CAPACITY;
+    }
+    record->monotonic_ns = monotonic_ns();
+    record->payload = payload;
+    record->pid = process_id;
+    record->event = event;
+    record->length = static_cast<std::uint16_t>(length);
+    if (length > 0) {
+        std::memcpy(record->text, text, length);
+    }
+
+    // Fails only if the consumer took this process for dead, e.g. after its
+    // pid was reused.
+    std::uint64_t expected = log_claim_token(pos, process_id);
+    return record->sequence.compare_exchange_strong(expected, pos + 1, std::memory_order_release);
+}
+
+std::size_t log_ring_drain(LogRing* ring, LogEntry* out, std::size_t max_entries) {
+    static std::uint64_t stalled_pos = UINT64_MAX;
+    static std::chrono::steady_clock::time_point stalled_since;
+    static std::chrono::steady_clock::time_point checked_at;
+
+    std::uint64_t pos = ring->dequeue_pos.load(std::memory_order_relaxed);
+    std::size_t count = 0;
+
+    while (count < max_entries) {
+        LogRecord& record = ring->records[pos & RING_MASK];
+        std::uint64_t sequence = record.sequence.load(std::memory_order_acquire);
+
+        if (sequence == pos + 1) {
+            LogEntry& entry = out[count++];
+            entry.monotonic_ns = record.monotonic_ns;
+            entry.payload = record.payload;
+            entry.pid = record.pid;
+            entry.event = record.event;
+            entry.length = record.length;
+            std::memcpy(entry.text, record.text, record.length);
+            record.sequence.store(pos + LOG_RING_SLOTS, std::memory_order_release);
+            ++pos;
+            continue;
+        }
+
+        // Slot is empty, or claimed by a producer that has not published it yet.
+        if (!claimed_in_lap(sequence, pos)) {
+            break;
+        }
+        auto now = std::chrono::steady_clock::now();
+        if (stalled_pos != pos) {
+            stalled_pos = pos;
+            stalled_since = now;
+            checked_at = now;
+            break;
+        }
+        if (now - checked_at < ABANDON_TIMEOUT) {
+            break;
+        }
+        // A live writer (slow, stopped or being debugged) still owns the
+        // slot: check again after another timeout, up to ABANDON_LIMIT.
+        if (now - stalled_since < ABANDON_LIMIT && process_alive(static_cast<std::uint32_t>(sequence))) {
+            checked_at = now;
+            break;
+        }
+        std::uint64_t expected = sequence;
+        if (record.sequence.compare_exchange_strong(expected, pos + LOG_RING_SLOTS, std::memory_order_acq_rel)) {
+            ring->abandoned.fetch_add(1, std::memory_order_relaxed);
+            ++pos;
+        }
+    }
+
+    ring->dequeue_pos.store(pos, std::memory_order_relaxed);
+    return count;
+}
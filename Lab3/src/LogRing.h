@@ -0,0 +1,86 @@
+#ifndef LOG_RING_H
+#define LOG_RING_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include "CacheLine.h"
+#include "LogEvents.h"
+
+// Bounded multi-producer, single-consumer queue of structured log records that
+// lives in the shared segment. Any process appends a record without a syscall,
+// the leader drains it from one writer thread (see LogWriter.h).
+
+constexpr std::size_t LOG_RING_SLOTS = 1024; // must be a power of two
+constexpr std::size_t LOG_RECORD_SIZE = 256;
+constexpr std::size_t LOG_TEXT_CAPACITY = LOG_RECORD_SIZE - 4 * sizeof(std::uint64_t);
+
+static_assert((LOG_RING_SLOTS & (LOG_RING_SLOTS - 1)) == 0, "LOG_RING_SLOTS must be a power of two");
+
+// `sequence` tells the state of the slot for position `pos` in the ring:
+// pos - free, log_claim_token(pos, pid) - being written by process `pid`,
+// pos + 1 - published, pos + LOG_RING_SLOTS - consumed (free for the next lap).
+struct alignas(CACHE_LINE_SIZE) LogRecord {
+    std::atomic<std::uint64_t> sequence;
+    std::int64_t monotonic_ns; // time of the log call
+    std::int64_t payload;
+    std::uint32_t pid;
+    std::uint16_t event;
+    std::uint16_t length;
+    char text[LOG_TEXT_CAPACITY];
+};
+
+static_assert(sizeof(LogRecord) == LOG_RECORD_SIZE, "LogRecord must stay fixed size");
+
+// Claimed slots have the top bit set, which no position ever reaches. The
+// token holds the lap of `pos` so a claim left over from the previous lap is
+// not mistaken for one of the current lap, and the pid of the writer so the
+// consumer can tell whether it is still alive.
+constexpr std::uint64_t LOG_CLAIM_BIT = std::uint64_t(1) << 63;
+
+constexpr std::uint64_t log_claim_token(std::uint64_t pos, std::uint32_t pid) {
+    return LOG_CLAIM_BIT | (((pos / LOG_RING_SLOTS) & 0x7FFFFFFF) << 32) | pid;
+}
+
+struct LogRing {
+    alignas(CACHE_LINE_SIZE) std::atomic<std::uint64_t> enqueue_pos;
+    alignas(CACHE_LINE_SIZE) std::atomic<std::uint64_t> dequeue_pos;
+    alignas(CACHE_LINE_SIZE) std::atomic<std::uint64_t> dropped;   // ring was full
+    std::atomic<std::uint64_t> abandoned;                          // producer died mid-write
+    LogRecord records[LOG_RING_SLOTS];
+};
+
+// Record copied out of the ring by the consumer.
+struct LogEntry {
+    std::int64_t monotonic_ns;
+    std::int64_t payload;
+    std::uint32_t pid;
+    std::uint16_t event;
+    std::uint16_t length;
+    char text[LOG_TEXT_CAPACITY];
+};
+
+// Monotonic clock shared by all processes on the machine, in nanoseconds.
+std::int64_t monotonic_ns();
+
+// Sets the PID stamped on records pushed by this process. Must be called at
+// startup and again in a forked child.
+void set_log_process_id(std::uint32_t pid);
+
+// Called once by the creator of the segment.
+void init_log_ring(LogRing* ring);
+
+// Appends a record, `text` is optional and truncated to LOG_TEXT_CAPACITY.
+// Never blocks: when the ring is full the record is dropped and counted in `dropped`.
+bool log_ring_push(LogRing* ring, LogEvent event, std::int64_t payload,
+                   const char* text = nullptr, std::size_t length = 0);
+
+// Copies up to `max_entries` published records into `out` and frees their
+// slots. A slot whose writer has died is skipped and counted in `abandoned`;
+// one whose writer is still alive is waited for, so a slot is not handed to
+// the next lap while somebody may still write into it - up to a hard limit
+// of 30 s, after which the pid is assumed to have been reused. Must only be
+// called from a single consumer at a time.
+std::size_t log_ring_drain(LogRing* ring, LogEntry* out, std::size_t max_entries);
+
+#endif
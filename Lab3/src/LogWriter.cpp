@@ -0,0 +1,483 @@
+#include "LogWriter.h"
+#include "BinaryLog.h"
+#include "TimestampFormatter.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <iostream>
+
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#else
+#include <sys/uio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+namespace {
+
+constexpr std::size_t BATCH_SIZE = 64;
+
+// Timestamp, " - ", rendered message and newline.
+constexpr std::size_t LINE_CAPACITY = TimestampFormatter::LENGTH + 3 + LOG_TEXT_CAPACITY + 64;
+
+// Binary logs get a fresh clock anchor at least this often, so wall clock
+// adjustments show up in rendered times.
+constexpr std::int64_t ANCHOR_INTERVAL_NS = 60LL * 1000000000;
+
+// How long the writer sleeps when the ring is empty.
+const auto IDLE_SLEEP = std::chrono::milliseconds(5);
+
+// Buffered mode writes out the collected batches at this size or age.
+constexpr std::size_t BUFFERED_FLUSH_SIZE = 64 * 1024;
+const auto BUFFERED_FLUSH_INTERVAL = std::chrono::seconds(1);
+
+// After a failed rotation the current file is kept and the next attempt is
+// made this many seconds later.
+constexpr std::time_t ROTATION_RETRY_SECONDS = 10;
+
+struct Span {
+    const void* data;
+    std::size_t size;
+};
+
+LogRing* writer_ring = nullptr;
+LogFormat writer_format = LogFormat::Text;
+int log_fd = -1;
+int arena_fd = -1;
+std::uint64_t arena_size = 0;
+std::int64_t last_anchor_ns = 0;
+std::thread writer_thread;
+std::atomic<bool> writer_stop(false);
+
+LogSyncPolicy sync_policy;
+
+std::string log_path;
+std::unique_ptr<LogRotator> rotator;
+std::uint64_t log_size = 0; // including bytes still pending in buffered mode
+std::time_t rotation_retry_at = 0;
+bool rotation_failed = false; // reported, not reported again until a rotation succeeds
+
+// Held by the syncer around fdatasync and by the writer while it swaps the
+// file on rotation, so the syncer never uses a closed descriptor.
+std::mutex file_mutex;
+
+// Buffered mode: bytes not yet written, per file. The arena is always
+// written out first, so no record on disk points past its end.
+std::vector<char> pending_log;
+std::vector<char> pending_arena;
+std::chrono::steady_clock::time_point last_flush;
+
+// Group commit state, shared by the writer and the syncer thread.
+std::thread syncer_thread;
+std::mutex sync_mutex;
+std::condition_variable sync_wakeup;
+std::uint64_t unsynced_records = 0;
+bool syncer_stop = false;
+
+LogEntry batch[BATCH_SIZE];
+TimestampFormatter timestamp_formatter;
+char text_buffer[BATCH_SIZE * LINE_CAPACITY];
+BinaryLogRecord binary_records[BATCH_SIZE + 1];
+
+#ifdef _WIN32
+int open_log_file(const std::string& path, bool binary) {
+    return _open(path.c_str(), _O_RDWR | _O_CREAT | _O_APPEND | (binary ? _O_BINARY : _O_TEXT), _S_IREAD | _S_IWRITE);
+}
+
+void close_log_file(int fd) {
+    _close(fd);
+}
+
+std::int64_t file_size(int fd) {
+    return _lseeki64(fd, 0, SEEK_END);
+}
+
+bool read_at_start(int fd, void* data, std::size_t size) {
+    _lseeki64(fd, 0, SEEK_SET);
+    return _read(fd, data, static_cast<unsigned int>(size)) == static_cast<int>(size);
+}
+
+void truncate_file(int fd, std::int64_t size) {
+    _chsize_s(fd, size);
+}
+
+void sync_file(int fd) {
+    if (_commit(fd) == -1) {
+        std::cerr << "Failed to sync log file." << std::endl;
+    }
+}
+
+void write_spans(int fd, const Span* spans, std::size_t count) {
+    for (std::size_t i = 0; i < count; ++i) {
+        if (_write(fd, spans[i].data, static_cast<unsigned int>(spans[i].size)) == -1) {
+            std::cerr << "Failed to write log file." << std::endl;
+            return;
+        }
+    }
+}
+#else
+int open_log_file(const std::string& path, bool) {
+    return open(path.c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+}
+
+void close_log_file(int fd) {
+    close(fd);
+}
+
+std::int64_t file_size(int fd) {
+    return lseek(fd, 0, SEEK_END);
+}
+
+bool read_at_start(int fd, void* data, std::size_t size) {
+    return pread(fd, data, size, 0) == static_cast<ssize_t>(size);
+}
+
+void truncate_file(int fd, std::int64_t size) {
+    if (ftruncate(fd, size) == -1) {
+        perror("Failed to truncate log file");
+    }
+}
+
+void sync_file(int fd) {
+    if (fdatasync(fd) == -1) {
+        perror("Failed to sync log file");
+    }
+}
+
+// One writev for all spans, retried on short writes.
+void write_spans(int fd, const Span* spans, std::size_t count) {
+    struct iovec iov[BATCH_SIZE];
+    int iov_count = 0;
+    for (std::size_t i = 0; i < count; ++i) {
+        iov[iov_count++] = { const_cast<void*>(spans[i].data), spans[i].size };
+    }
+
+    struct iovec* next = iov;
+    while (iov_count > 0) {
+        ssize_t written = writev(fd, next, iov_count);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("Failed to write log file");
+            return;
+        }
+        while (iov_count > 0 && static_cast<std::size_t>(written) >= next->iov_len) {
+            written -= next->iov_len;
+            ++next;
+            --iov_count;
+        }
+        if (iov_count > 0) {
+            next->iov_base = static_cast<char*>(next->iov_base) + written;
+            next->iov_len -= written;
+        }
+    }
+}
+#endif
+
+void flush_pending() {
+    if (!pending_arena.empty()) {
+        Span span = { pending_arena.data(), pending_arena.size() };
+        write_spans(arena_fd, &span, 1);
+        pending_arena.clear();
+    }
+    if (!pending_log.empty()) {
+        Span span = { pending_log.data(), pending_log.size() };
+        write_spans(log_fd, &span, 1);
+        pending_log.clear();
+    }
+    last_flush = std::chrono::steady_clock::now();
+}
+
+// Appends to `fd` now, or to its pending buffer in buffered mode.
+void output_spans(int fd, const Span* spans, std::size_t count) {
+    if (sync_policy.mode != LogSync::Buffered) {
+        write_spans(fd, spans, count);
+        return;
+    }
+    std::vector<char>& pending = fd == arena_fd ? pending_arena : pending_log;
+    for (std::size_t i = 0; i < count; ++i) {
+        const char* data = static_cast<const char*>(spans[i].data);
+        pending.insert(pending.end(), data, data + spans[i].size);
+    }
+    if (pending_log.size() + pending_arena.size() >= BUFFERED_FLUSH_SIZE) {
+        flush_pending();
+    }
+}
+
+// Syncs whenever the interval has passed since the first unsynced record or
+// the writer reports enough records. Writes go on during fdatasync, the
+// records they add are picked up by the next round.
+void syncer_loop() {
+    std::unique_lock<std::mutex> lock(sync_mutex);
+    while (true) {
+        sync_wakeup.wait(lock, []() { return syncer_stop || unsynced_records > 0; });
+        if (!syncer_stop) {
+            sync_wakeup.wait_for(lock, std::chrono::milliseconds(sync_policy.interval_ms), []() {
+                return syncer_stop || unsynced_records >= static_cast<std::uint64_t>(sync_policy.records);
+            });
+        }
+        bool stopping = syncer_stop;
+        std::uint64_t records = unsynced_records;
+        lock.unlock();
+
+        if (records > 0) {
+            std::lock_guard<std::mutex> files(file_mutex);
+            if (arena_fd != -1) {
+                sync_file(arena_fd);
+            }
+            sync_file(log_fd);
+        }
+
+        lock.lock();
+        unsynced_records -= records;
+        if (stopping) {
+            break;
+        }
+    }
+}
+
+void records_written(std::size_t count) {
+    if (sync_policy.mode != LogSync::Group) {
+        return;
+    }
+    bool wake = false;
+    {
+        std::lock_guard<std::mutex> lock(sync_mutex);
+        wake = unsynced_records == 0 || unsynced_records + count >= static_cast<std::uint64_t>(sync_policy.records);
+        unsynced_records += count;
+    }
+    if (wake) {
+        sync_wakeup.notify_one();
+    }
+}
+
+// Called before `bytes` are appended to the text log.
+void rotate_if_needed(std::size_t bytes) {
+    if (!rotator) {
+        return;
+    }
+    std::time_t now = std::time(nullptr);
+    if (now < rotation_retry_at || !rotator->should_rotate(log_size + bytes, now)) {
+        return;
+    }
+    flush_pending();
+
+    std::lock_guard<std::mutex> files(file_mutex);
+    if (sync_policy.mode == LogSync::Group) {
+        // Whatever the syncer has not covered yet goes out with the old file.
+        sync_file(log_fd);
+    }
+#ifdef _WIN32
+    // An open file cannot be renamed on Windows.
+    close_log_file(log_fd);
+#endif
+    // The new file is opened before the old descriptor is given up, so a
+    // failed open leaves the writer on the file it had.
+    int next_fd = -1;
+    bool rotated = rotator->rotate(now, [&] {
+        next_fd = open_log_file(log_path, false);
+        if (next_fd == -1 && !rotation_failed) {
+            perror("Failed to open a new log file after rotation");
+        }
+        return next_fd != -1;
+    });
+    if (!rotated) {
+#ifdef _WIN32
+        log_fd = open_log_file(log_path, false);
+#endif
+        if (!rotation_failed) {
+            std::cerr << "Log rotation failed, still writing to " << log_path << std::endl;
+            rotation_failed = true;
+        }
+        rotation_retry_at = now + ROTATION_RETRY_SECONDS;
+        return;
+    }
+#ifndef _WIN32
+    close_log_file(log_fd);
+#endif
+    log_fd = next_fd;
+    log_size = static_cast<std::uint64_t>(file_size(log_fd));
+    rotation_failed = false;
+}
+
+// Offset that turns a monotonic timestamp into wall clock time.
+std::int64_t clock_offset() {
+    return TimestampFormatter::now_ns() - monotonic_ns();
+}
+
+void write_text_batch(std::size_t count) {
+    std::int64_t offset = clock_offset();
+    std::size_t length = 0;
+    for (std::size_t i = 0; i < count; ++i) {
+        const LogEntry& entry = batch[i];
+        char* line = text_buffer + length;
+        std::size_t n = timestamp_formatter.format(entry.monotonic_ns + offset, line);
+        std::memcpy(line + n, " - ", 3);
+        n += 3;
+        n += render_log_event(entry.event, entry.payload, entry.pid, entry.text, entry.length,
+                              line + n, LINE_CAPACITY - n - 1);
+        line[n++] = '\n';
+        length += n;
+    }
+    rotate_if_needed(length);
+    Span span = { text_buffer, length };
+    output_spans(log_fd, &span, 1);
+    log_size += length;
+}
+
+// Texts go to the arena first, so a record never points past its end.
+void write_binary_batch(std::size_t count) {
+    std::size_t record_count = 0;
+    Span texts[BATCH_SIZE];
+    std::size_t text_count = 0;
+
+    std::int64_t now = monotonic_ns();
+    if (last_anchor_ns == 0 || now - last_anchor_ns >= ANCHOR_INTERVAL_NS) {
+        binary_records[record_count++] = { now, clock_offset(), 0, 0, EVENT_CLOCK_ANCHOR, 0 };
+        last_anchor_ns = now;
+    }
+
+    for (std::size_t i = 0; i < count; ++i) {
+        const LogEntry& entry = batch[i];
+        binary_records[record_count++] = { entry.monotonic_ns, entry.payload, entry.length > 0 ? arena_size : 0,
+                                           entry.pid, entry.event, entry.length };
+        if (entry.length > 0) {
+            texts[text_count++] = { entry.text, entry.length };
+            arena_size += entry.length;
+        }
+    }
+
+    if (text_count > 0) {
+        output_spans(arena_fd, texts, text_count);
+    }
+    Span records = { binary_records, record_count * sizeof(BinaryLogRecord) };
+    output_spans(log_fd, &records, 1);
+}
+
+bool open_binary_log(const std::string& path) {
+    std::int64_t size = file_size(log_fd);
+    if (size == 0) {
+        BinaryLogHeader header = {};
+        std::memcpy(header.magic, BINARY_LOG_MAGIC, sizeof(header.magic));
+        header.version = BINARY_LOG_VERSION;
+        header.record_size = sizeof(BinaryLogRecord);
+        Span span = { &header, sizeof(header) };
+        write_spans(log_fd, &span, 1);
+    } else {
+        BinaryLogHeader header = {};
+        if (!read_at_start(log_fd, &header, sizeof(header)) ||
+            std::memcmp(header.magic, BINARY_LOG_MAGIC, sizeof(header.magic)) != 0 ||
+            header.version != BINARY_LOG_VERSION) {
+            std::cerr << path << " is not a binary Timer log." << std::endl;
+            return false;
+        }
+        // Drop a record torn by a crash, so appended records stay aligned.
+        std::int64_t tail = (size - static_cast<std::int64_t>(sizeof(header))) % sizeof(BinaryLogRecord);
+        if (tail != 0) {
+            truncate_file(log_fd, size - tail);
+        }
+    }
+
+    arena_fd = open_log_file(binary_log_arena_path(path), true);
+    if (arena_fd == -1) {
+        return false;
+    }
+    arena_size = static_cast<std::uint64_t>(file_size(arena_fd));
+    last_anchor_ns = 0;
+    return true;
+}
+
+void writer_loop() {
+    while (true) {
+        bool stopping = writer_stop.load(std::memory_order_acquire);
+        std::size_t count = log_ring_drain(writer_ring, batch, BATCH_SIZE);
+        if (count > 0) {
+            if (writer_format == LogFormat::Binary) {
+                write_binary_batch(count);
+            } else {
+                write_text_batch(count);
+            }
+            records_written(count);
+            continue;
+        }
+        if (stopping) {
+            break;
+        }
+        if (sync_policy.mode == LogSync::Buffered &&
+            std::chrono::steady_clock::now() - last_flush >= BUFFERED_FLUSH_INTERVAL) {
+            flush_pending();
+        }
+        std::this_thread::sleep_for(IDLE_SLEEP);
+    }
+}
+
+}
+
+bool start_log_writer(LogRing* ring, const std::string& path, LogFormat format, const LogSyncPolicy& sync,
+                      const RotationPolicy& rotation) {
+    if (writer_thread.joinable()) {
+        return true;
+    }
+    log_fd = open_log_file(path, format == LogFormat::Binary);
+    if (log_fd == -1) {
+        return false;
+    }
+    if (format == LogFormat::Binary && !open_binary_log(path)) {
+        close_log_file(log_fd);
+        log_fd = -1;
+        return false;
+    }
+    writer_ring = ring;
+    writer_format = format;
+    writer_stop = false;
+    sync_policy = sync;
+    log_path = path;
+    log_size = static_cast<std::uint64_t>(file_size(log_fd));
+    if (rotation.enabled() && format == LogFormat::Text) {
+        rotator.reset(new LogRotator(path, rotation));
+    }
+    last_flush = std::chrono::steady_clock::now();
+    if (sync_policy.mode == LogSync::Group) {
+        unsynced_records = 0;
+        syncer_stop = false;
+        syncer_thread = std::thread(syncer_loop);
+    }
+    writer_thread = std::thread(writer_loop);
+    return true;
+}
+
+void stop_log_writer() {
+    if (!writer_thread.joinable()) {
+        return;
+    }
+    writer_stop.store(true, std::memory_order_release);
+    writer_thread.join();
+    flush_pending();
+    if (syncer_thread.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(sync_mutex);
+            syncer_stop = true;
+        }
+        sync_wakeup.notify_one();
+        syncer_thread.join();
+    }
+    close_log_file(log_fd);
+    log_fd = -1;
+    rotator.reset();
+    if (arena_fd != -1) {
+        close_log_file(arena_fd);
+        arena_fd = -1;
+    }
+}
@@ -0,0 +1,40 @@
+#ifndef LOG_WRITER_H
+#define LOG_WRITER_H
+
+#include <string>
+#include "LogRing.h"
+#include "LogRotator.h"
+
+enum class LogFormat {
+    Text,   // rendered lines, see render_log_event
+    Binary  // fixed-size records, see BinaryLog.h and the timerlog tool
+};
+
+// How far a logged line has got when the writer reports it written.
+enum class LogSync {
+    Buffered, // collected in memory, written out every 64 KB or once a second
+    Batch,    // one write per drained batch, left to the page cache
+    Group     // written per batch and fdatasync'ed by a separate thread
+};
+
+struct LogSyncPolicy {
+    LogSync mode = LogSync::Batch;
+    // Group commit: sync when this much time has passed since the first
+    // unsynced record, or earlier once this many records are unsynced.
+    int interval_ms = 100;
+    int records = 1000;
+};
+
+// Starts the thread that drains `ring` and appends its records to the file at
+// `path` in batches. Only the leader runs it. Returns false if the file cannot be opened.
+// With an enabled `rotation` the text log is rotated between batches (see
+// LogRotator.h); binary logs are never rotated.
+bool start_log_writer(LogRing* ring, const std::string& path, LogFormat format,
+                      const LogSyncPolicy& sync = LogSyncPolicy(),
+                      const RotationPolicy& rotation = RotationPolicy());
+
+// Writes out everything still queued in the ring and stops the writer thread.
+// In group mode the file is synced once more before it is closed.
+void stop_log_writer();
+
+#endif
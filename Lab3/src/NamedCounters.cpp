@@ -0,0 +1,203 @@
+#include "NamedCounters.h"
+#include <chrono>
+#include <cstring>
+#include <new>
+#include <thread>
+#include "InstanceRegistry.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace {
+
+constexpr std::uint64_t SLOT_CLAIMED = 1;   // the claiming process is still writing the name
+constexpr std::uint64_t SLOT_READY = 2;
+constexpr std::uint64_t SLOT_ABANDONED = 3; // the claimer died first; skipped, never reused
+constexpr std::uint64_t SLOT_STATE_MASK = 3;
+
+// A claimed tag also carries the claimer's PID above the hash bits.
+constexpr int CLAIMER_SHIFT = 34;
+constexpr std::uint64_t SLOT_HASH_MASK = ((std::uint64_t(1) << CLAIMER_SHIFT) - 1) & ~SLOT_STATE_MASK;
+
+// Writing a name takes microseconds. A claim is given up when its process
+// is dead, checked this often, or once it is older than CLAIM_TIMEOUT in
+// case the PID was reused.
+const auto CLAIM_CHECK_INTERVAL = std::chrono::milliseconds(10);
+const auto CLAIM_TIMEOUT = std::chrono::seconds(1);
+
+// FNV-1a; the low bits pick the first slot, the high 32 bits go into the tag.
+std::uint64_t name_hash(const std::string& name) {
+    std::uint64_t hash = 14695981039346656037ull;
+    for (unsigned char c : name) {
+        hash ^= c;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+std::uint64_t make_tag(std::uint64_t hash, std::uint64_t state) {
+    // Never 0, that is a free slot.
+    return ((hash >> 32) | 1u) << 2 | state;
+}
+
+std::uint64_t claimed_tag(std::uint64_t hash) {
+#ifdef _WIN32
+    std::uint64_t pid = GetCurrentProcessId();
+#else
+    std::uint64_t pid = static_cast<std::uint64_t>(getpid());
+#endif
+    return make_tag(hash, SLOT_CLAIMED) | (pid & ((std::uint64_t(1) << (64 - CLAIMER_SHIFT)) - 1)) << CLAIMER_SHIFT;
+}
+
+// Waits while `slot` is claimed and returns its tag once the name is
+// written, or after marking the claim abandoned.
+std::uint64_t wait_for_claim(NamedCounterSlot& slot, std::uint64_t tag) {
+    auto claimed_at = std::chrono::steady_clock::now();
+    auto next_check = claimed_at + CLAIM_CHECK_INTERVAL;
+    while ((tag & SLOT_STATE_MASK) == SLOT_CLAIMED) {
+        auto now = std::chrono::steady_clock::now();
+        if (now >= next_check) {
+            next_check = now + CLAIM_CHECK_INTERVAL;
+            if (now - claimed_at >= CLAIM_TIMEOUT ||
+                !process_alive(static_cast<std::uint32_t>(tag >> CLAIMER_SHIFT))) {
+                // The slot cannot simply be freed: names claimed after it may
+                // sit further along its probe sequences.
+                slot.tag.compare_exchange_strong(tag, (tag & SLOT_HASH_MASK) | SLOT_ABANDONED,
+                                                 std::memory_order_acquire);
+                continue;
+            }
+        }
+        std::this_thread::yield();
+        tag = slot.tag.load(std::memory_order_acquire);
+    }
+    return tag;
+}
+
+bool same_name(const NamedCounterSlot& slot, const std::string& name) {
+    return std::strncmp(slot.name, name.c_str(), NAMED_COUNTER_KEY_SIZE) == 0;
+}
+
+// Slot holding `name`, claimed for it when `create` is set. nullptr when the
+// name is absent (or the table is full).
+NamedCounterSlot* find_slot(const NamedCounters* counters, const std::string& name, bool create) {
+    auto* table = const_cast<NamedCounters*>(counters);
+    std::uint64_t hash = name_hash(name);
+    std::uint64_t ready_tag = make_tag(hash, SLOT_READY);
+    std::size_t index = hash & (NAMED_COUNTER_SLOTS - 1);
+
+    for (std::size_t probe = 0; probe < NAMED_COUNTER_SLOTS; ++probe) {
+        NamedCounterSlot& slot = table->slots[index];
+        std::uint64_t tag = slot.tag.load(std::memory_order_acquire);
+
+        if (tag == 0) {
+            // Free slots end every probe sequence, as nothing is ever removed.
+            if (!create) {
+                return nullptr;
+            }
+            std::uint64_t claim = claimed_tag(hash);
+            if (slot.tag.compare_exchange_strong(tag, claim, std::memory_order_acquire)) {
+                std::memset(slot.name, 0, sizeof(slot.name));
+                name.copy(slot.name, NAMED_COUNTER_KEY_SIZE - 1);
+                slot.value.store(0, std::memory_order_relaxed);
+                if (slot.tag.compare_exchange_strong(claim, ready_tag, std::memory_order_release)) {
+                    return &slot;
+                }
+                // This process was stopped long enough for the claim to be
+                // abandoned, the name may have been created further on since.
+                index = (index + 1) & (NAMED_COUNTER_SLOTS - 1);
+                continue;
+            }
+            // Somebody else claimed it first, `tag` now holds their tag.
+        }
+
+        if ((tag & SLOT_HASH_MASK) == (ready_tag & SLOT_HASH_MASK)) {
+            // Same hash: wait for the name if it is still being written. Slots
+            // of other names are skipped without waiting.
+            tag = wait_for_claim(slot, tag);
+            if ((tag & SLOT_STATE_MASK) == SLOT_READY && same_name(slot, name)) {
+                return &slot;
+            }
+        }
+        index = (index + 1) & (NAMED_COUNTER_SLOTS - 1);
+    }
+    return nullptr;
+}
+
+}
+
+void init_named_counters(NamedCounters* counters) {
+    for (NamedCounterSlot& slot : counters->slots) {
+        new (&slot.tag) std::atomic<std::uint64_t>(0);
+        std::memset(slot.name, 0, sizeof(slot.name));
+        new (&slot.value) std::atomic<std::int64_t>(0);
+    }
+}
+
+bool valid_counter_name(const std::string& name) {
+    if (name.empty() || name.size() >= NAMED_COUNTER_KEY_SIZE) {
+        return false;
+    }
+    auto letter = [](char c) { return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_'; };
+    if (!letter(name[0])) {
+        return false;
+    }
+    for (char c : name) {
+        if (!letter(c) && !(c >= '0' && c <= '9') && c != '.' && c != ':' && c != '-') {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool named_counter_get(const NamedCounters* counters, const std::string& name, std::int64_t& value) {
+    if (!valid_counter_name(name)) {
+        return false;
+    }
+    NamedCounterSlot* slot = find_slot(counters, name, false);
+    if (!slot) {
+        return false;
+    }
+    value = slot->value.load(std::memory_order_relaxed);
+    return true;
+}
+
+bool named_counter_set(NamedCounters* counters, const std::string& name, std::int64_t value) {
+    if (!valid_counter_name(name)) {
+        return false;
+    }
+    NamedCounterSlot* slot = find_slot(counters, name, true);
+    if (!slot) {
+        return false;
+    }
+    slot->value.store(value, std::memory_order_relaxed);
+    return true;
+}
+
+bool named_counter_add(NamedCounters* counters, const std::string& name, std::int64_t delta, std::int64_t& result) {
+    if (!valid_counter_name(name)) {
+        return false;
+    }
+    NamedCounterSlot* slot = find_slot(counters, name, true);
+    if (!slot) {
+        return false;
+    }
+    // Wraps like the unsigned arithmetic it is.
+    result = static_cast<std::int64_t>(
+        static_cast<std::uint64_t>(slot->value.fetch_add(delta, std::memory_order_relaxed)) +
+        static_cast<std::uint64_t>(delta));
+    return true;
+}
+
+std::vector<std::pair<std::string, std::int64_t>> list_named_counters(const NamedCounters* counters) {
+    std::vector<std::pair<std::string, std::int64_t>> result;
+    for (const NamedCounterSlot& slot : counters->slots) {
+        if ((slot.tag.load(std::memory_order_acquire) & SLOT_STATE_MASK) == SLOT_READY) {
+            result.emplace_back(std::string(slot.name, strnlen(slot.name, NAMED_COUNTER_KEY_SIZE)),
+                                slot.value.load(std::memory_order_relaxed));
+        }
+    }
+    return result;
+}
@@ -0,0 +1,57 @@
+#ifndef NAMED_COUNTERS_H
+#define NAMED_COUNTERS_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+#include "CacheLine.h"
+
+// Power of two, the table is probed with a mask.
+constexpr std::size_t NAMED_COUNTER_SLOTS = 4096;
+
+// Names are stored in place, zero padded; the longest name is one byte shorter.
+constexpr std::size_t NAMED_COUNTER_KEY_SIZE = 48;
+
+// One counter per cache line. `tag` is 0 while the slot is free, otherwise
+// the upper 32 bits of the name hash and the slot state in the low bits;
+// while the name is being written it also holds the writer's PID.
+struct alignas(CACHE_LINE_SIZE) NamedCounterSlot {
+    std::atomic<std::uint64_t> tag;
+    char name[NAMED_COUNTER_KEY_SIZE];
+    std::atomic<std::int64_t> value;
+};
+
+static_assert(sizeof(NamedCounterSlot) == CACHE_LINE_SIZE, "a named counter must fit one cache line");
+
+// Open-addressing hash table of counters in the shared segment, with linear
+// probing. A counter is created on first write by claiming a free slot with
+// one CAS; its name never changes afterwards and counters are never removed,
+// so lookups and updates are plain atomic operations without any lock or
+// syscall, from any process that has the segment mapped. A slot whose
+// claimer died before writing the name is marked abandoned by the next
+// lookup that meets it and stays unused.
+struct NamedCounters {
+    NamedCounterSlot slots[NAMED_COUNTER_SLOTS];
+};
+
+void init_named_counters(NamedCounters* counters);
+
+// 1 to NAMED_COUNTER_KEY_SIZE - 1 characters: a letter or '_' followed by
+// letters, digits and "_.:-", so a name never looks like a number.
+bool valid_counter_name(const std::string& name);
+
+// Returns false when there is no counter with this name.
+bool named_counter_get(const NamedCounters* counters, const std::string& name, std::int64_t& value);
+
+// Both create the counter (starting at 0) when it does not exist yet. They
+// return false for an invalid name or when the table is full.
+bool named_counter_set(NamedCounters* counters, const std::string& name, std::int64_t value);
+bool named_counter_add(NamedCounters* counters, const std::string& name, std::int64_t delta, std::int64_t& result);
+
+// All counters in table order.
+std::vector<std::pair<std::string, std::int64_t>> list_named_counters(const NamedCounters* counters);
+
+#endif
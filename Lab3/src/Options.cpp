@@ -0,0 +1,167 @@
+#include "Options.h"
+#include <iostream>
+#include <string>
+#include <cstdlib>
+#include <limits>
+
+namespace {
+
+void print_usage(const char* program) {
+    std::cerr << "Usage: " << program << " [options]\n"
+              << "       " << program << " <child id>\n"
+              << "Options:\n"
+              << "  --log-format=text|binary  format of the log file (default: text)\n"
+              << "  --log-sync=MODE           buffered - write every 64 KB or 1 s, batch - write every\n"
+              << "                            batch (default), group - also fdatasync in groups\n"
+              << "  --log-sync-ms=MS          group: longest time a record stays unsynced (default 100)\n"
+              << "  --log-sync-records=N      group: sync early after N records (default 1000)\n"
+              << "  --log-rotate-size=MB      rotate the text log once it would exceed MB megabytes\n"
+              << "  --log-rotate=hourly|daily rotate the text log at every hour / local midnight\n"
+              << "  --log-keep=N              keep at most N rotated logs\n"
+              << "  --log-keep-days=N         remove rotated logs older than N days\n"
+              << "  --rt-tick=MS              real-time tick mode: increment the counter every MS ms\n"
+              << "                            from a SCHED_FIFO thread, SIGUSR1 dumps the jitter histogram\n"
+              << "  --rt-cpu=N                pin the real-time tick thread to CPU N\n"
+              << "  --rt-priority=N           SCHED_FIFO priority of the tick thread (default: 80)\n"
+              << "  --child-config=PATH       child scripts, one per line: \"mul 2; sleep 2000; div 2\"\n"
+              << "  --child-fanout=N          copies started every spawn cycle (default: one per script)\n"
+              << "  --max-children=N          copies running at once, a cycle that would exceed it\n"
+              << "                            is skipped (default: the fan-out)\n"
+              << "  --control-socket=PATH     control socket of the leader, see timerctl\n"
+              << "                            (default: " << DEFAULT_CONTROL_SOCKET << ")\n"
+              << "  --watch-coalesce=MS       batch counter changes sent to watchers over MS ms\n"
+              << "  --persist=PATH            keep the segment in PATH, the counter survives restarts\n"
+              << "  --persist-interval=MS     how often the leader saves the counter (default 1000)\n";
+}
+
+[[noreturn]] void usage_error(const char* program, const std::string& message) {
+    std::cerr << message << std::endl;
+    print_usage(program);
+    exit(1);
+}
+
+int parse_int(const char* program, const std::string& name, const std::string& value, int min, int max) {
+    try {
+        std::size_t used = 0;
+        int result = std::stoi(value, &used);
+        if (used == value.size() && result >= min && result <= max) {
+            return result;
+        }
+    } catch (...) {
+    }
+    usage_error(program, "Invalid value for " + name + ": " + value);
+}
+
+bool starts_with(const std::string& value, const char* prefix, std::string& rest) {
+    std::string p(prefix);
+    if (value.compare(0, p.size(), p) != 0) {
+        return false;
+    }
+    rest = value.substr(p.size());
+    return true;
+}
+
+}
+
+TimerOptions parse_options(int argc, char* argv[]) {
+    TimerOptions options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        std::string value;
+
+        if (arg == "--help" || arg == "-h") {
+            print_usage(argv[0]);
+            exit(0);
+        } else if (starts_with(arg, "--log-format=", value)) {
+            if (value == "text") {
+                options.log_format = LogFormat::Text;
+            } else if (value == "binary") {
+                options.log_format = LogFormat::Binary;
+            } else {
+                usage_error(argv[0], "Unknown log format: " + value);
+            }
+        } else if (starts_with(arg, "--log-sync=", value)) {
+            if (value == "buffered") {
+                options.log_sync.mode = LogSync::Buffered;
+            } else if (value == "batch") {
+                options.log_sync.mode = LogSync::Batch;
+            } else if (value == "group") {
+                options.log_sync.mode = LogSync::Group;
+            } else {
+                usage_error(argv[0], "Unknown log sync mode: " + value);
+            }
+        } else if (starts_with(arg, "--log-sync-ms=", value)) {
+            options.log_sync.interval_ms = parse_int(argv[0], "--log-sync-ms", value, 1, 60 * 1000);
+        } else if (starts_with(arg, "--log-sync-records=", value)) {
+            options.log_sync.records = parse_int(argv[0], "--log-sync-records", value, 1, 1000000);
+        } else if (starts_with(arg, "--log-rotate-size=", value)) {
+            options.log_rotation.max_bytes =
+                static_cast<std::uint64_t>(parse_int(argv[0], "--log-rotate-size", value, 1, 1024 * 1024)) << 20;
+        } else if (starts_with(arg, "--log-rotate=", value)) {
+            if (value == "hourly") {
+                options.log_rotation.interval = RotationInterval::Hourly;
+            } else if (value == "daily") {
+                options.log_rotation.interval = RotationInterval::Daily;
+            } else {
+                usage_error(argv[0], "Unknown rotation interval: " + value);
+            }
+        } else if (starts_with(arg, "--log-keep=", value)) {
+            options.log_rotation.keep_files = parse_int(argv[0], "--log-keep", value, 1, 100000);
+        } else if (starts_with(arg, "--log-keep-days=", value)) {
+            options.log_rotation.max_age_days = parse_int(argv[0], "--log-keep-days", value, 1, 100000);
+        } else if (starts_with(arg, "--rt-tick=", value)) {
+            options.rt_tick_ms = parse_int(argv[0], "--rt-tick", value, 1, 3600 * 1000);
+        } else if (starts_with(arg, "--rt-cpu=", value)) {
+            options.rt_cpu = parse_int(argv[0], "--rt-cpu", value, 0, 1023);
+        } else if (starts_with(arg, "--rt-priority=", value)) {
+            options.rt_priority = parse_int(argv[0], "--rt-priority", value, 1, 99);
+        } else if (starts_with(arg, "--child-config=", value)) {
+            options.child_config = value;
+        } else if (starts_with(arg, "--child-fanout=", value)) {
+            options.child_fanout = parse_int(argv[0], "--child-fanout", value, 1, 100000);
+        } else if (starts_with(arg, "--max-children=", value)) {
+            options.max_children = parse_int(argv[0], "--max-children", value, 1, 100000);
+        } else if (starts_with(arg, "--control-socket=", value)) {
+            options.control_socket = value;
+        } else if (starts_with(arg, "--watch-coalesce=", value)) {
+            options.watch_coalesce_ms = parse_int(argv[0], "--watch-coalesce", value, 0, 60 * 1000);
+        } else if (starts_with(arg, "--persist=", value)) {
+            if (value.empty()) {
+                usage_error(argv[0], "--persist needs a file path");
+            }
+            options.persist_path = value;
+        } else if (starts_with(arg, "--persist-interval=", value)) {
+            options.persist_interval_ms = parse_int(argv[0], "--persist-interval", value, 10, 60 * 60 * 1000);
+        } else if (!arg.empty() && arg.find_first_not_of("0123456789") == std::string::npos && options.child_id == 0) {
+            options.child_id = parse_int(argv[0], "child id", arg, 1, std::numeric_limits<int>::max());
+        } else {
+            usage_error(argv[0], "Unknown argument: " + arg);
+        }
+    }
+    // A cycle never fits under a limit below its own fan-out. With the default
+    // fan-out the check is left to check_child_limits() once the scripts are loaded.
+    if (options.child_fanout > 0 && options.max_children > 0 && options.max_children < options.child_fanout) {
+        usage_error(argv[0], "--max-children must not be below --child-fanout");
+    }
+    if (options.log_rotation.enabled() && options.log_format == LogFormat::Binary) {
+        usage_error(argv[0], "Log rotation is only supported for the text log");
+    }
+    // Without rotation there are no rotated logs to keep or remove.
+    if (!options.log_rotation.enabled() &&
+        (options.log_rotation.keep_files > 0 || options.log_rotation.max_age_days > 0)) {
+        usage_error(argv[0], "--log-keep and --log-keep-days need --log-rotate or --log-rotate-size");
+    }
+    return options;
+}
+
+void check_child_limits(const char* program, const TimerOptions& options, std::size_t script_count) {
+    if (options.child_fanout == 0 && options.max_children > 0 &&
+        static_cast<std::size_t>(options.max_children) < script_count) {
+        usage_error(program, "--max-children must not be below the fan-out (" + std::to_string(script_count) +
+                             " child scripts), set --child-fanout");
+    }
+}
+
+const char* log_file_path(const TimerOptions& options) {
+    return options.log_format == LogFormat::Binary ? "../logs/timer.blog" : "../logs/timer.log";
+}
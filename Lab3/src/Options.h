@@ -0,0 +1,36 @@
+#ifndef OPTIONS_H
+#define OPTIONS_H
+
+#include <cstddef>
+#include <string>
+#include "LogWriter.h"
+#include "ControlProtocol.h"
+
+struct TimerOptions {
+    int child_id = 0; // "Timer <id>" runs copy <id> instead of a full instance
+    LogFormat log_format = LogFormat::Text;
+    LogSyncPolicy log_sync;
+    RotationPolicy log_rotation;
+    int rt_tick_ms = 0;   // > 0 enables the real-time tick mode with this period
+    int rt_cpu = -1;
+    int rt_priority = 80;
+    std::string child_config;  // child script file, empty for the built-in copies
+    int child_fanout = 0;      // copies started per spawn cycle, 0 - one per script
+    int max_children = 0;      // copies running at once, 0 - same as child_fanout
+    std::string control_socket = DEFAULT_CONTROL_SOCKET;
+    int watch_coalesce_ms = 0; // watchers get at most one change per window
+    std::string persist_path;  // file backing the shared segment, empty for shm
+    int persist_interval_ms = 1000;
+};
+
+// Parses the command line, prints usage and exits on invalid arguments.
+TimerOptions parse_options(int argc, char* argv[]);
+
+// Exits with usage when --max-children is below the default fan-out of one
+// copy per script, which is only known once the scripts are loaded.
+void check_child_limits(const char* program, const TimerOptions& options, std::size_t script_count);
+
+// Log file written by the leader for the chosen format.
+const char* log_file_path(const TimerOptions& options);
+
+#endif
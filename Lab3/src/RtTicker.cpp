@@ -0,0 +1,122 @@
+#include "RtTicker.h"
+#include <atomic>
+#include <cstring>
+#include <iostream>
+#include <thread>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <cerrno>
+#endif
+
+namespace {
+
+std::thread ticker_thread;
+std::atomic<bool> ticker_stop(false);
+LatencyHistogram tick_histogram;
+
+#ifdef _WIN32
+void configure_thread(const RtTickerConfig& config) {
+    if (!SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL)) {
+        std::cerr << "RT tick: could not raise thread priority: " << GetLastError() << std::endl;
+    }
+    if (config.cpu >= 0 && !SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR(1) << config.cpu)) {
+        std::cerr << "RT tick: could not pin to CPU " << config.cpu << ": " << GetLastError() << std::endl;
+    }
+}
+
+void ticker_loop(RtTickerConfig config, std::function<void()> tick) {
+    configure_thread(config);
+    auto next = std::chrono::steady_clock::now();
+    while (!ticker_stop.load(std::memory_order_relaxed)) {
+        next += config.period;
+        std::this_thread::sleep_until(next);
+        tick_histogram.record(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - next).count());
+        tick();
+    }
+}
+#else
+void configure_thread(const RtTickerConfig& config) {
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) == -1) {
+        std::cerr << "RT tick: mlockall failed: " << std::strerror(errno) << std::endl;
+    }
+
+    struct sched_param param = {};
+    param.sched_priority = config.priority;
+    int error = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+    if (error != 0) {
+        std::cerr << "RT tick: SCHED_FIFO unavailable: " << std::strerror(error) << std::endl;
+    }
+
+#ifdef __linux__
+    if (config.cpu >= 0) {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(config.cpu, &cpus);
+        error = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+        if (error != 0) {
+            std::cerr << "RT tick: could not pin to CPU " << config.cpu << ": " << std::strerror(error) << std::endl;
+        }
+    }
+#endif
+
+    // Touch the stack now, so the loop never takes a page fault on it.
+    volatile char prefault[64 * 1024];
+    std::memset(const_cast<char*>(prefault), 0, sizeof(prefault));
+}
+
+std::int64_t to_ns(const struct timespec& ts) {
+    return static_cast<std::int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+void ticker_loop(RtTickerConfig config, std::function<void()> tick) {
+    configure_thread(config);
+
+    const long period_ns = static_cast<long>(std::chrono::duration_cast<std::chrono::nanoseconds>(config.period).count());
+    struct timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+
+    while (!ticker_stop.load(std::memory_order_relaxed)) {
+        next.tv_nsec += period_ns;
+        while (next.tv_nsec >= 1000000000) {
+            next.tv_nsec -= 1000000000;
+            next.tv_sec++;
+        }
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, nullptr) == EINTR) {
+        }
+
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        tick_histogram.record(to_ns(now) - to_ns(next));
+        tick();
+    }
+}
+#endif
+
+}
+
+void start_rt_ticker(const RtTickerConfig& config, std::function<void()> tick) {
+    if (ticker_thread.joinable()) {
+        return;
+    }
+    ticker_stop = false;
+    ticker_thread = std::thread(ticker_loop, config, std::move(tick));
+}
+
+void stop_rt_ticker() {
+    if (!ticker_thread.joinable()) {
+        return;
+    }
+    ticker_stop = true;
+    ticker_thread.join();
+}
+
+LatencyHistogram& rt_tick_histogram() {
+    return tick_histogram;
+}
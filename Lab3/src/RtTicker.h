@@ -0,0 +1,24 @@
+#ifndef RT_TICKER_H
+#define RT_TICKER_H
+
+#include <chrono>
+#include <functional>
+#include "LatencyHistogram.h"
+
+struct RtTickerConfig {
+    std::chrono::microseconds period;
+    int cpu = -1;       // pin the tick thread to this CPU, -1 leaves it unpinned
+    int priority = 80;  // SCHED_FIFO priority
+};
+
+// Low-jitter tick mode: a dedicated SCHED_FIFO thread with locked memory that
+// sleeps with clock_nanosleep(TIMER_ABSTIME) to absolute deadlines and calls
+// `tick` every period. Lateness of every wakeup goes to rt_tick_histogram().
+// Real-time settings that need privileges degrade to a warning.
+void start_rt_ticker(const RtTickerConfig& config, std::function<void()> tick);
+
+void stop_rt_ticker();
+
+LatencyHistogram& rt_tick_histogram();
+
+#endif
@@ -0,0 +1,333 @@
+#include "Scheduler.h"
+#include <algorithm>
+#include <climits>
+#include <iostream>
+
+#ifdef __linux__
+#include <sys/timerfd.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdio>
+#endif
+
+namespace {
+
+constexpr std::int64_t NEVER = LLONG_MAX;
+
+}
+
+Scheduler::Scheduler() {
+    current_tick_ = static_cast<std::uint64_t>(now_ns() / TICK_NS);
+#ifdef __linux__
+    timer_fd_ = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+    if (timer_fd_ == -1) {
+        perror("Could not create scheduler timer");
+        exit(1);
+    }
+#endif
+}
+
+Scheduler::~Scheduler() {
+    stop();
+#ifdef __linux__
+    close(timer_fd_);
+#endif
+}
+
+std::int64_t Scheduler::now_ns() const {
+    // steady_clock is CLOCK_MONOTONIC, the clock the timerfd runs on.
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+Scheduler::TaskId Scheduler::add_periodic(const std::string& name, std::chrono::nanoseconds period, std::function<void()> task) {
+    std::int64_t deadline;
+    TaskId id;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        id = next_id_++;
+        deadline = now_ns() + period.count();
+        tasks_[id] = Task{ name, period.count(), deadline, std::move(task), true, 0, 0, 0, 0 };
+        insert(id, deadline);
+        wake(deadline);
+    }
+    return id;
+}
+
+void Scheduler::remove(TaskId id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = tasks_.find(id);
+    if (it != tasks_.end()) {
+        it->second.active = false;
+    }
+}
+
+void Scheduler::start() {
+    if (thread_.joinable()) {
+        return;
+    }
+    stop_ = false;
+    thread_ = std::thread(&Scheduler::run_loop, this);
+}
+
+void Scheduler::stop() {
+    if (!thread_.joinable()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+        wake(0);
+    }
+    if (thread_.get_id() == std::this_thread::get_id()) {
+        thread_.detach();
+    } else {
+        thread_.join();
+    }
+}
+
+std::vector<Scheduler::TaskStats> Scheduler::stats() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<TaskStats> result;
+    for (const auto& entry : tasks_) {
+        const Task& task = entry.second;
+        if (!task.active) {
+            continue;
+        }
+        std::int64_t mean = task.runs > 0 ? task.total_lateness_ns / static_cast<std::int64_t>(task.runs) : 0;
+        result.push_back({ task.name, task.period_ns, task.runs, task.missed, mean, task.max_lateness_ns });
+    }
+    std::sort(result.begin(), result.end(), [](const TaskStats& a, const TaskStats& b) { return a.name < b.name; });
+    return result;
+}
+
+// Level L holds tasks due within WHEEL_SLOTS^(L+1) ticks, in the slot picked
+// by bits [L * WHEEL_BITS, (L + 1) * WHEEL_BITS) of the expiry tick.
+void Scheduler::insert(TaskId id, std::int64_t deadline_ns) {
+    auto expires = static_cast<std::uint64_t>(deadline_ns / TICK_NS);
+    if (expires <= current_tick_) {
+        near_.push_back(id);
+        return;
+    }
+    std::uint64_t delta = expires - current_tick_;
+    for (int level = 0; level < WHEEL_LEVELS; ++level) {
+        if (delta < (1ull << (WHEEL_BITS * (level + 1)))) {
+            wheel_[level][(expires >> (WHEEL_BITS * level)) & (WHEEL_SLOTS - 1)].push_back(id);
+            return;
+        }
+    }
+    overflow_.push_back(id);
+}
+
+// Moves the wheel forward to `now_ns` and collects the tasks whose deadline has passed.
+void Scheduler::advance(std::int64_t now, std::vector<TaskId>& due) {
+    auto target = static_cast<std::uint64_t>(now / TICK_NS);
+    std::vector<TaskId> reached;
+
+    if (target > current_tick_ + WHEEL_SLOTS * WHEEL_SLOTS) {
+        // Woke up after a long stall (e.g. suspend), rebuilding is cheaper than stepping.
+        for (auto& level : wheel_) {
+            for (auto& slot : level) {
+                reached.insert(reached.end(), slot.begin(), slot.end());
+                slot.clear();
+            }
+        }
+        reached.insert(reached.end(), overflow_.begin(), overflow_.end());
+        overflow_.clear();
+        current_tick_ = target;
+    }
+
+    while (current_tick_ < target) {
+        std::uint64_t tick = ++current_tick_;
+
+        // Cascade higher levels when the level below wraps around.
+        for (int level = 1; level < WHEEL_LEVELS; ++level) {
+            if ((tick & ((1ull << (WHEEL_BITS * level)) - 1)) != 0) {
+                break;
+            }
+            auto& slot = wheel_[level][(tick >> (WHEEL_BITS * level)) & (WHEEL_SLOTS - 1)];
+            std::vector<TaskId> cascaded;
+            cascaded.swap(slot);
+            if (level == WHEEL_LEVELS - 1) {
+                cascaded.insert(cascaded.end(), overflow_.begin(), overflow_.end());
+                overflow_.clear();
+            }
+            for (TaskId id : cascaded) {
+                auto it = tasks_.find(id);
+                if (it != tasks_.end()) {
+                    insert(id, it->second.deadline_ns);
+                }
+            }
+        }
+
+        auto& slot = wheel_[0][tick & (WHEEL_SLOTS - 1)];
+        reached.insert(reached.end(), slot.begin(), slot.end());
+        slot.clear();
+    }
+
+    reached.insert(reached.end(), near_.begin(), near_.end());
+    near_.clear();
+
+    for (TaskId id : reached) {
+        auto it = tasks_.find(id);
+        if (it == tasks_.end()) {
+            continue;
+        }
+        if (!it->second.active) {
+            tasks_.erase(it);
+        } else if (it->second.deadline_ns <= now) {
+            due.push_back(id);
+        } else {
+            insert(id, it->second.deadline_ns);
+        }
+    }
+}
+
+std::int64_t Scheduler::next_wakeup_ns() {
+    std::int64_t best = NEVER;
+    for (TaskId id : near_) {
+        auto it = tasks_.find(id);
+        if (it != tasks_.end()) {
+            best = std::min(best, it->second.deadline_ns);
+        }
+    }
+
+    // Level 0 holds exact deadlines, higher levels only need a wakeup to cascade.
+    for (std::uint64_t k = 1; k <= WHEEL_SLOTS; ++k) {
+        const auto& slot = wheel_[0][(current_tick_ + k) & (WHEEL_SLOTS - 1)];
+        if (slot.empty()) {
+            continue;
+        }
+        for (TaskId id : slot) {
+            auto it = tasks_.find(id);
+            if (it != tasks_.end()) {
+                best = std::min(best, it->second.deadline_ns);
+            }
+        }
+        break;
+    }
+
+    for (int level = 1; level < WHEEL_LEVELS; ++level) {
+        std::uint64_t base = current_tick_ >> (WHEEL_BITS * level);
+        for (std::uint64_t k = 1; k <= WHEEL_SLOTS; ++k) {
+            if (!wheel_[level][(base + k) & (WHEEL_SLOTS - 1)].empty() ||
+                (level == WHEEL_LEVELS - 1 && k == 1 && !overflow_.empty())) {
+                auto tick = static_cast<std::int64_t>((base + k) << (WHEEL_BITS * level));
+                best = std::min(best, tick * TICK_NS);
+                break;
+            }
+        }
+    }
+    return best;
+}
+
+#ifdef __linux__
+void Scheduler::wake(std::int64_t deadline_ns) {
+    if (deadline_ns >= armed_ns_) {
+        return;
+    }
+    armed_ns_ = deadline_ns;
+    struct itimerspec spec = {};
+    // An all-zero value would disarm the timer, 1 ns in the past fires at once.
+    std::int64_t value = std::max<std::int64_t>(deadline_ns, 1);
+    spec.it_value.tv_sec = value / 1000000000;
+    spec.it_value.tv_nsec = value % 1000000000;
+    timerfd_settime(timer_fd_, TFD_TIMER_ABSTIME, &spec, nullptr);
+}
+
+// The deadline is computed under the same lock add_periodic() takes, so a
+// task added meanwhile either is seen here or re-arms the timer itself.
+void Scheduler::wait_for_next() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::int64_t deadline_ns = stop_ ? 0 : next_wakeup_ns();
+        armed_ns_ = NEVER;
+        if (deadline_ns != NEVER) {
+            wake(deadline_ns);
+        } else {
+            struct itimerspec spec = {};
+            timerfd_settime(timer_fd_, TFD_TIMER_ABSTIME, &spec, nullptr);
+        }
+    }
+    std::uint64_t expirations;
+    while (read(timer_fd_, &expirations, sizeof(expirations)) == -1 && errno == EINTR) {
+    }
+}
+#else
+void Scheduler::wake(std::int64_t deadline_ns) {
+    if (deadline_ns < armed_ns_) {
+        armed_ns_ = deadline_ns;
+        wakeup_.notify_one();
+    }
+}
+
+void Scheduler::wait_for_next() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    armed_ns_ = next_wakeup_ns();
+    while (!stop_ && now_ns() < armed_ns_) {
+        if (armed_ns_ == NEVER) {
+            wakeup_.wait(lock);
+        } else {
+            wakeup_.wait_for(lock, std::chrono::nanoseconds(armed_ns_ - now_ns()));
+        }
+    }
+}
+#endif
+
+void Scheduler::run_loop() {
+    std::vector<TaskId> due;
+    std::vector<std::int64_t> lateness;
+
+    while (!stop_) {
+        wait_for_next();
+        if (stop_) {
+            break;
+        }
+
+        due.clear();
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            advance(now_ns(), due);
+        }
+
+        // Tasks run without the lock, so they can add or remove tasks. Map
+        // entries are only erased by this thread, so the pointers stay valid.
+        lateness.clear();
+        for (TaskId id : due) {
+            Task* task;
+            bool active;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                task = &tasks_.find(id)->second;
+                active = task->active;
+            }
+            lateness.push_back(now_ns() - task->deadline_ns);
+            if (active) {
+                task->callback();
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::int64_t now = now_ns();
+        for (std::size_t i = 0; i < due.size(); ++i) {
+            auto it = tasks_.find(due[i]);
+            Task& task = it->second;
+            if (!task.active) {
+                tasks_.erase(it);
+                continue;
+            }
+            task.runs++;
+            task.total_lateness_ns += lateness[i];
+            task.max_lateness_ns = std::max(task.max_lateness_ns, lateness[i]);
+
+            std::int64_t deadline = task.deadline_ns + task.period_ns;
+            if (deadline <= now) {
+                std::int64_t skipped = (now - deadline) / task.period_ns + 1;
+                deadline += skipped * task.period_ns;
+                task.missed += static_cast<std::uint64_t>(skipped);
+            }
+            task.deadline_ns = deadline;
+            insert(due[i], deadline);
+        }
+    }
+}
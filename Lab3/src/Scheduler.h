@@ -0,0 +1,94 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Runs every periodic task of the process on one thread. Deadlines are
+// absolute (previous deadline + period), so waking up late never shifts the
+// following runs. Pending tasks are kept in a hierarchical timer wheel and the
+// thread sleeps on a timerfd armed for the earliest deadline.
+class Scheduler {
+public:
+    using TaskId = std::uint32_t;
+
+    struct TaskStats {
+        std::string name;
+        std::int64_t period_ns;
+        std::uint64_t runs;
+        std::uint64_t missed;            // periods skipped because the task ran too late
+        std::int64_t mean_lateness_ns;
+        std::int64_t max_lateness_ns;
+    };
+
+    Scheduler();
+    ~Scheduler();
+
+    Scheduler(const Scheduler&) = delete;
+    Scheduler& operator=(const Scheduler&) = delete;
+
+    // Runs `task` every `period`, first one period from now. Can be called
+    // from any thread, including from inside a task.
+    TaskId add_periodic(const std::string& name, std::chrono::nanoseconds period, std::function<void()> task);
+
+    // The task will not run again. A run that is already in progress completes.
+    void remove(TaskId id);
+
+    void start();
+    void stop();
+
+    std::vector<TaskStats> stats();
+
+private:
+    static constexpr int WHEEL_LEVELS = 4;
+    static constexpr int WHEEL_BITS = 6;
+    static constexpr std::uint64_t WHEEL_SLOTS = 1u << WHEEL_BITS;
+    static constexpr std::int64_t TICK_NS = 1000000;
+
+    struct Task {
+        std::string name;
+        std::int64_t period_ns;
+        std::int64_t deadline_ns;
+        std::function<void()> callback;
+        bool active;
+        std::uint64_t runs;
+        std::uint64_t missed;
+        std::int64_t total_lateness_ns;
+        std::int64_t max_lateness_ns;
+    };
+
+    void run_loop();
+    void insert(TaskId id, std::int64_t deadline_ns);
+    void advance(std::int64_t now_ns, std::vector<TaskId>& due);
+    std::int64_t next_wakeup_ns();
+    void wait_for_next();
+    void wake(std::int64_t deadline_ns);
+    std::int64_t now_ns() const;
+
+    std::mutex mutex_;
+    std::unordered_map<TaskId, Task> tasks_;
+    std::vector<TaskId> wheel_[WHEEL_LEVELS][WHEEL_SLOTS];
+    std::vector<TaskId> near_;      // reached by the wheel, deadline still ahead within a tick
+    std::vector<TaskId> overflow_;  // beyond the range of the last level
+    std::uint64_t current_tick_ = 0;
+    std::int64_t armed_ns_ = 0;
+    TaskId next_id_ = 1;
+
+    std::atomic<bool> stop_{false};
+    std::thread thread_;
+#ifdef __linux__
+    int timer_fd_ = -1;
+#else
+    std::condition_variable wakeup_;
+#endif
+};
+
+#endif
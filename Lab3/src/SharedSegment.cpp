@@ -0,0 +1,422 @@
+#include "SharedSegment.h"
+#include <iostream>
+#include <thread>
+#include <chrono>
+#include <ctime>
+#include <cstdlib>
+#include <new>
+#include <cstddef>
+#include "TimestampFormatter.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/file.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#endif
+
+namespace {
+
+const char* const SEGMENT_NAME =
+#ifdef _WIN32
+    "SharedCounter";
+#else
+    "/SharedCounter";
+#endif
+
+// How long an attaching instance waits for the creator to finish initialization.
+const auto INIT_TIMEOUT = std::chrono::seconds(1);
+
+#ifndef _WIN32
+void init_counter_lock(pthread_mutex_t* lock) {
+    pthread_mutexattr_t attributes;
+    pthread_mutexattr_init(&attributes);
+    pthread_mutexattr_setpshared(&attributes, PTHREAD_PROCESS_SHARED);
+    pthread_mutexattr_setrobust(&attributes, PTHREAD_MUTEX_ROBUST);
+    int error = pthread_mutexattr_setprotocol(&attributes, PTHREAD_PRIO_INHERIT);
+    if (error != 0) {
+        std::cerr << "Counter lock without priority inheritance: " << std::strerror(error) << std::endl;
+    }
+    error = pthread_mutex_init(lock, &attributes);
+    pthread_mutexattr_destroy(&attributes);
+    if (error != 0) {
+        std::cerr << "Could not initialize the counter lock: " << std::strerror(error) << std::endl;
+        exit(1);
+    }
+}
+#endif
+
+void initialize_segment(SharedSegment* segment) {
+    segment->header.layout_version = SEGMENT_LAYOUT_VERSION;
+    segment->header.segment_size = sizeof(SharedSegment);
+    segment->header.created_at = static_cast<std::int64_t>(std::time(nullptr));
+
+    new (&segment->counter) std::atomic<int>(0);
+    new (&segment->leader) std::atomic<bool>(true);
+#ifndef _WIN32
+    init_counter_lock(&segment->counter_lock);
+#endif
+    init_log_ring(&segment->log_ring);
+    new (&segment->counter_sequence) std::atomic<std::uint32_t>(0);
+    new (&segment->counter_waiters) std::atomic<std::uint32_t>(0);
+    init_state_block(&segment->state);
+    init_instance_registry(&segment->registry);
+    init_named_counters(&segment->named_counters);
+
+    segment->header.magic.store(SEGMENT_MAGIC, std::memory_order_release);
+}
+
+// Waits until the creator has published the header and checks that this
+// binary understands the layout. Prints the reason when it does not.
+bool compatible_segment(const SharedSegment* segment) {
+    auto start_time = std::chrono::steady_clock::now();
+    while (segment->header.magic.load(std::memory_order_acquire) != SEGMENT_MAGIC) {
+        if (std::chrono::steady_clock::now() - start_time > INIT_TIMEOUT) {
+            std::cerr << "Shared memory segment " << SEGMENT_NAME << " is not a Timer segment." << std::endl;
+            return false;
+        }
+        std::this_thread::yield();
+    }
+
+    if (segment->header.layout_version != SEGMENT_LAYOUT_VERSION ||
+        segment->header.segment_size != sizeof(SharedSegment)) {
+        std::cerr << "Shared memory segment " << SEGMENT_NAME << " has layout version "
+                  << segment->header.layout_version << " (" << segment->header.segment_size
+                  << " bytes), expected version " << SEGMENT_LAYOUT_VERSION << " (" << sizeof(SharedSegment)
+                  << " bytes). Stop the other instances or remove the segment." << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void validate_segment(SharedSegment* segment) {
+    if (!compatible_segment(segment)) {
+        exit(1);
+    }
+}
+
+// Bitwise CRC-32 (IEEE), the records are only a few dozen bytes.
+std::uint32_t crc32(const void* data, std::size_t size) {
+    std::uint32_t crc = 0xFFFFFFFFu;
+    const auto* bytes = static_cast<const unsigned char*>(data);
+    for (std::size_t i = 0; i < size; ++i) {
+        crc ^= bytes[i];
+        for (int bit = 0; bit < 8; ++bit) {
+            crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u)));
+        }
+    }
+    return ~crc;
+}
+
+std::uint32_t record_checksum(const DurableCounterRecord& record) {
+    return crc32(&record, offsetof(DurableCounterRecord, checksum));
+}
+
+// Newest record that was completely written, nullptr if there is none.
+const DurableCounterRecord* latest_durable_record(const DurableCounter& durable) {
+    const DurableCounterRecord* latest = nullptr;
+    for (const DurableCounterRecord& record : durable.records) {
+        if (record.generation != 0 && record.checksum == record_checksum(record) &&
+            (!latest || record.generation > latest->generation)) {
+            latest = &record;
+        }
+    }
+    return latest;
+}
+
+}
+
+#ifdef _WIN32
+SharedSegment* attach_shared_segment(bool& created, const std::string& persist_path) {
+    if (!persist_path.empty()) {
+        std::cerr << "File-backed segments are not supported on Windows." << std::endl;
+        exit(1);
+    }
+
+    HANDLE hMapFile = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 0, sizeof(SharedSegment), SEGMENT_NAME);
+    if (hMapFile == NULL) {
+        std::cerr << "Could not create file mapping object: " << GetLastError() << std::endl;
+        exit(1);
+    }
+    created = GetLastError() != ERROR_ALREADY_EXISTS;
+
+    void* base_address = MapViewOfFile(hMapFile, FILE_MAP_ALL_ACCESS, 0, 0, sizeof(SharedSegment));
+    if (base_address == NULL) {
+        std::cerr << "Could not map view of file: " << GetLastError() << std::endl;
+        CloseHandle(hMapFile);
+        exit(1);
+    }
+
+    auto* segment = static_cast<SharedSegment*>(base_address);
+    if (created) {
+        initialize_segment(segment);
+    } else {
+        validate_segment(segment);
+    }
+    return segment;
+}
+
+const SharedSegment* open_shared_segment_readonly(const std::string& persist_path) {
+    if (!persist_path.empty()) {
+        std::cerr << "File-backed segments are not supported on Windows." << std::endl;
+        return nullptr;
+    }
+
+    HANDLE hMapFile = OpenFileMappingA(FILE_MAP_READ, FALSE, SEGMENT_NAME);
+    if (hMapFile == NULL) {
+        std::cerr << "No Timer instance is running." << std::endl;
+        return nullptr;
+    }
+    void* base_address = MapViewOfFile(hMapFile, FILE_MAP_READ, 0, 0, sizeof(SharedSegment));
+    CloseHandle(hMapFile);
+    if (base_address == NULL) {
+        std::cerr << "Could not map view of file: " << GetLastError() << std::endl;
+        return nullptr;
+    }
+    auto* segment = static_cast<const SharedSegment*>(base_address);
+    if (!compatible_segment(segment)) {
+        detach_shared_segment(segment);
+        return nullptr;
+    }
+    return segment;
+}
+
+void detach_shared_segment(const SharedSegment* segment) {
+    if (segment) {
+        UnmapViewOfFile(segment);
+    }
+}
+
+void remove_shared_segment() {
+    // The mapping object is destroyed with its last handle.
+}
+
+void persist_counter(SharedSegment*) {
+}
+#else
+namespace {
+
+// Descriptor of a file-backed segment, kept open for its flock.
+int persistent_fd = -1;
+
+// The first instance on a file restores the counter from the newest durable
+// record; everything else in the segment belonged to dead processes and is
+// initialized again.
+SharedSegment* attach_persistent_segment(const std::string& path, bool& created) {
+    // Attaching is serialized on a lock file next to the segment, so the
+    // moment when the first instance trades its exclusive lock on the
+    // segment for a shared one (flock drops the old lock first) cannot be
+    // mistaken by another instance for "nobody is running".
+    int init_fd = open((path + ".lock").c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (init_fd == -1 || flock(init_fd, LOCK_EX) == -1) {
+        perror(("Could not lock " + path + ".lock").c_str());
+        exit(1);
+    }
+
+    int fd = open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd == -1) {
+        perror(("Could not open " + path).c_str());
+        exit(1);
+    }
+
+    // Running instances hold shared locks, so an exclusive one means none is left.
+    created = flock(fd, LOCK_EX | LOCK_NB) == 0;
+    if (!created) {
+        if (errno != EWOULDBLOCK || flock(fd, LOCK_SH) == -1) {
+            perror("Could not lock segment file");
+            exit(1);
+        }
+    }
+
+    struct stat st {};
+    if (fstat(fd, &st) == -1) {
+        perror("Could not stat segment file");
+        exit(1);
+    }
+    bool fresh = st.st_size == 0;
+    if (fresh && created) {
+        if (ftruncate(fd, sizeof(SharedSegment)) == -1) {
+            perror("Could not set size of segment file");
+            exit(1);
+        }
+    } else if (st.st_size != static_cast<off_t>(sizeof(SharedSegment))) {
+        std::cerr << path << " is " << st.st_size << " bytes, expected " << sizeof(SharedSegment)
+                  << ". It was written by a Timer with a different segment layout." << std::endl;
+        exit(1);
+    }
+
+    void* addr = mmap(nullptr, sizeof(SharedSegment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (addr == MAP_FAILED) {
+        perror("Could not map segment file");
+        exit(1);
+    }
+    auto* segment = static_cast<SharedSegment*>(addr);
+
+    if (created) {
+        std::int64_t counter = 0;
+        // Magic 0: a crash between ftruncate and initialize_segment left the
+        // file zero-filled, nothing was ever saved in it.
+        std::uint32_t magic = segment->header.magic.load(std::memory_order_relaxed);
+        if (!fresh && magic != 0) {
+            if (magic != SEGMENT_MAGIC || segment->header.layout_version != SEGMENT_LAYOUT_VERSION) {
+                std::cerr << path << " is not a Timer segment of layout version " << SEGMENT_LAYOUT_VERSION
+                          << "." << std::endl;
+                exit(1);
+            }
+            const DurableCounterRecord* record = latest_durable_record(segment->durable);
+            if (record) {
+                counter = record->counter;
+            }
+        }
+        initialize_segment(segment);
+        segment->counter.store(static_cast<int>(counter));
+        publish_counter_state(&segment->state, static_cast<int>(counter));
+
+        if (flock(fd, LOCK_SH) == -1) {
+            perror("Could not lock segment file");
+            exit(1);
+        }
+    } else {
+        validate_segment(segment);
+    }
+    close(init_fd);
+
+    persistent_fd = fd;
+    return segment;
+}
+
+}
+
+SharedSegment* attach_shared_segment(bool& created, const std::string& persist_path) {
+    if (!persist_path.empty()) {
+        return attach_persistent_segment(persist_path, created);
+    }
+
+    created = false;
+    int fd = shm_open(SEGMENT_NAME, O_CREAT | O_EXCL | O_RDWR, 0666);
+
+    if (fd != -1) { // leader instance, creating variables
+        created = true;
+        if (ftruncate(fd, sizeof(SharedSegment)) == -1) {
+            perror("Could not set size for shared memory");
+            close(fd);
+            shm_unlink(SEGMENT_NAME);
+            exit(1);
+        }
+    } else if (errno == EEXIST) { // additional instance
+        fd = shm_open(SEGMENT_NAME, O_RDWR, 0666);
+        if (fd == -1) {
+            perror("Could not open shared memory");
+            exit(1);
+        }
+
+        // The creator may not have sized the segment yet.
+        struct stat st {};
+        auto start_time = std::chrono::steady_clock::now();
+        while (fstat(fd, &st) == 0 && st.st_size == 0 &&
+               std::chrono::steady_clock::now() - start_time < INIT_TIMEOUT) {
+            std::this_thread::yield();
+        }
+        if (st.st_size < static_cast<off_t>(sizeof(SharedSegment))) {
+            std::cerr << "Shared memory segment " << SEGMENT_NAME << " is " << st.st_size
+                      << " bytes, expected " << sizeof(SharedSegment)
+                      << ". Stop the other instances or remove the segment." << std::endl;
+            close(fd);
+            exit(1);
+        }
+    } else {
+        perror("Could not create shared memory");
+        exit(1);
+    }
+
+    void* addr = mmap(nullptr, sizeof(SharedSegment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED) {
+        perror("Could not map shared memory");
+        if (created) {
+            shm_unlink(SEGMENT_NAME);
+        }
+        exit(1);
+    }
+
+    auto* segment = static_cast<SharedSegment*>(addr);
+    if (created) {
+        initialize_segment(segment);
+    } else {
+        validate_segment(segment);
+    }
+    return segment;
+}
+
+const SharedSegment* open_shared_segment_readonly(const std::string& persist_path) {
+    int fd = persist_path.empty() ? shm_open(SEGMENT_NAME, O_RDONLY, 0)
+                                  : open(persist_path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        std::cerr << "No Timer instance is running." << std::endl;
+        return nullptr;
+    }
+    struct stat st {};
+    if (fstat(fd, &st) == -1 || st.st_size < static_cast<off_t>(sizeof(SharedSegment))) {
+        std::cerr << "Shared memory segment " << SEGMENT_NAME << " has an unexpected size." << std::endl;
+        close(fd);
+        return nullptr;
+    }
+    void* addr = mmap(nullptr, sizeof(SharedSegment), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED) {
+        perror("Could not map shared memory");
+        return nullptr;
+    }
+    auto* segment = static_cast<const SharedSegment*>(addr);
+    if (!compatible_segment(segment)) {
+        detach_shared_segment(segment);
+        return nullptr;
+    }
+    return segment;
+}
+
+void detach_shared_segment(const SharedSegment* segment) {
+    if (segment) {
+        munmap(const_cast<SharedSegment*>(segment), sizeof(SharedSegment));
+    }
+}
+
+void remove_shared_segment() {
+    if (persistent_fd != -1) {
+        // Closing releases the flock; the file keeps the durable counter.
+        close(persistent_fd);
+        persistent_fd = -1;
+        return;
+    }
+    shm_unlink(SEGMENT_NAME);
+}
+
+void persist_counter(SharedSegment* segment) {
+    if (persistent_fd == -1) {
+        return;
+    }
+    const DurableCounterRecord* latest = latest_durable_record(segment->durable);
+    std::uint64_t generation = latest ? latest->generation + 1 : 1;
+
+    DurableCounterRecord& record = segment->durable.records[generation % 2];
+    record.generation = generation;
+    record.counter = segment->counter.load();
+    record.saved_at_ns = TimestampFormatter::now_ns();
+    record.padding = 0;
+    record.checksum = record_checksum(record);
+
+    // msync needs a page aligned start.
+    static const long page_size = sysconf(_SC_PAGESIZE);
+    auto begin = reinterpret_cast<std::uintptr_t>(&segment->durable);
+    auto page = begin & ~static_cast<std::uintptr_t>(page_size - 1);
+    if (msync(reinterpret_cast<void*>(page), begin + sizeof(DurableCounter) - page, MS_SYNC) == -1) {
+        perror("Could not sync segment file");
+    }
+}
+#endif
@@ -0,0 +1,114 @@
+#ifndef SHARED_SEGMENT_H
+#define SHARED_SEGMENT_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "CacheLine.h"
+#include "LogRing.h"
+#include "SharedState.h"
+#include "InstanceRegistry.h"
+#include "NamedCounters.h"
+
+#ifndef _WIN32
+#include <pthread.h>
+#endif
+
+constexpr std::uint32_t SEGMENT_MAGIC = 0x53524D54; // "TMRS"
+
+// Any change to the layout of SharedSegment, including its size, must bump
+// the version, so an instance never attaches to a segment it cannot read.
+constexpr std::uint32_t SEGMENT_LAYOUT_VERSION = 10;
+
+// Written once by the creator. Attaching instances wait for `magic` to be
+// published and then check the version and size before touching anything else.
+struct alignas(CACHE_LINE_SIZE) SegmentHeader {
+    std::atomic<std::uint32_t> magic;
+    std::uint32_t layout_version;
+    std::uint64_t segment_size;
+    std::int64_t created_at;
+};
+
+// Last value of the counter known to be on disk, for file-backed segments.
+// The two records are written alternately, each with its own checksum, so a
+// crash while one is being written leaves the other one intact.
+struct DurableCounterRecord {
+    std::uint64_t generation;      // 0 - never written
+    std::int64_t counter;
+    std::int64_t saved_at_ns;      // wall clock
+    std::uint32_t checksum;        // CRC-32 of the fields above
+    std::uint32_t padding;
+};
+
+struct alignas(CACHE_LINE_SIZE) DurableCounter {
+    DurableCounterRecord records[2];
+};
+
+struct SharedSegment {
+    SegmentHeader header;
+
+    alignas(CACHE_LINE_SIZE) std::atomic<int> counter;
+    alignas(CACHE_LINE_SIZE) std::atomic<bool> leader;
+
+#ifndef _WIN32
+    // Held around every counter update and every write of `state`. It uses
+    // priority inheritance, so a holder that the SCHED_FIFO ticker
+    // (RtTicker.h) is waiting for runs at the ticker's priority until it
+    // unlocks. It is robust: when a copy dies holding it, the next waiter
+    // gets it and repairs what the copy left (lock_counter()). Windows uses
+    // a named mutex instead.
+    alignas(CACHE_LINE_SIZE) pthread_mutex_t counter_lock;
+#endif
+
+    LogRing log_ring;
+
+    // Bumped after every counter change, watchers sleep on it (CounterWatch.h).
+    alignas(CACHE_LINE_SIZE) std::atomic<std::uint32_t> counter_sequence;
+    std::atomic<std::uint32_t> counter_waiters;
+
+    // Consistent copy of the instance state for lock-free readers (SharedState.h).
+    StateBlock state;
+
+    // Running instances and their statistics (InstanceRegistry.h).
+    InstanceRegistry registry;
+
+    // Only used when the segment is a file (persist_counter()).
+    DurableCounter durable;
+
+    // Counters created by name from any process (NamedCounters.h).
+    NamedCounters named_counters;
+};
+
+static_assert(alignof(SharedSegment) == CACHE_LINE_SIZE, "SharedSegment must be cache line aligned");
+static_assert(offsetof(SharedSegment, counter) % CACHE_LINE_SIZE == 0, "counter must start a cache line");
+static_assert(offsetof(SharedSegment, leader) - offsetof(SharedSegment, counter) >= CACHE_LINE_SIZE,
+              "counter and leader flag must not share a cache line");
+
+// Maps the "SharedCounter" segment, creating and initializing it when no other
+// instance holds it. `created` is set when this call initialized the segment.
+// Exits the process when the segment cannot be mapped or has an incompatible layout.
+//
+// With a `persist_path` the segment is that file instead of shared memory.
+// Every instance holds a shared flock on it; the instance that finds no other
+// holder initializes the segment and resumes the counter from the durable
+// record. The file is never removed.
+SharedSegment* attach_shared_segment(bool& created, const std::string& persist_path = "");
+
+// File-backed segments: writes the counter to the older durable record and
+// msyncs it. Does nothing for shared memory segments.
+void persist_counter(SharedSegment* segment);
+
+// Maps an existing segment read-only for monitoring. Returns nullptr, with a
+// message, when no instance is running or the layout does not match; never
+// creates the segment.
+const SharedSegment* open_shared_segment_readonly(const std::string& persist_path = "");
+
+// Unmaps the segment from this process.
+void detach_shared_segment(const SharedSegment* segment);
+
+// Removes the segment name, the memory is freed once every instance has detached.
+// A file-backed segment is kept.
+void remove_shared_segment();
+
+#endif
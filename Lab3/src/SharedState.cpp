@@ -0,0 +1,72 @@
+#include "SharedState.h"
+#include <new>
+#include <thread>
+#include "TimestampFormatter.h"
+
+namespace {
+
+// Returns the sequence to pass to end_write().
+std::uint32_t begin_write(StateBlock* block) {
+    std::uint32_t sequence = block->sequence.load(std::memory_order_relaxed);
+    block->sequence.store(sequence + 1, std::memory_order_relaxed);
+    // Readers that see any of the following stores also see the odd sequence.
+    std::atomic_thread_fence(std::memory_order_release);
+    return sequence + 2;
+}
+
+void end_write(StateBlock* block, std::uint32_t sequence) {
+    block->last_update_ns.store(TimestampFormatter::now_ns(), std::memory_order_relaxed);
+    block->sequence.store(sequence, std::memory_order_release);
+}
+
+}
+
+void init_state_block(StateBlock* block) {
+    new (&block->sequence) std::atomic<std::uint32_t>(0);
+    new (&block->counter) std::atomic<std::int32_t>(0);
+    new (&block->leader_pid) std::atomic<std::uint32_t>(0);
+    new (&block->leader_present) std::atomic<std::uint32_t>(0);
+    new (&block->last_update_ns) std::atomic<std::int64_t>(TimestampFormatter::now_ns());
+}
+
+void publish_counter_state(StateBlock* block, int counter) {
+    std::uint32_t sequence = begin_write(block);
+    block->counter.store(counter, std::memory_order_relaxed);
+    end_write(block, sequence);
+}
+
+void publish_leader_state(StateBlock* block, bool leader_present, std::uint32_t leader_pid) {
+    std::uint32_t sequence = begin_write(block);
+    block->leader_present.store(leader_present ? 1 : 0, std::memory_order_relaxed);
+    block->leader_pid.store(leader_pid, std::memory_order_relaxed);
+    end_write(block, sequence);
+}
+
+void repair_state_block(StateBlock* block) {
+    std::uint32_t sequence = block->sequence.load(std::memory_order_relaxed);
+    if (sequence & 1) {
+        block->sequence.store(sequence + 1, std::memory_order_release);
+    }
+}
+
+TimerState read_state_snapshot(const StateBlock* block) {
+    TimerState state;
+    for (int attempt = 0;; ++attempt) {
+        std::uint32_t before = block->sequence.load(std::memory_order_acquire);
+        if ((before & 1) == 0) {
+            state.counter = block->counter.load(std::memory_order_relaxed);
+            state.leader_present = block->leader_present.load(std::memory_order_relaxed) != 0;
+            state.leader_pid = block->leader_pid.load(std::memory_order_relaxed);
+            state.last_update_ns = block->last_update_ns.load(std::memory_order_relaxed);
+            // The field loads may not move below the second sequence load.
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (block->sequence.load(std::memory_order_relaxed) == before) {
+                return state;
+            }
+        }
+        // A writer is in the middle of an update, or was preempted there.
+        if (attempt >= 64) {
+            std::this_thread::yield();
+        }
+    }
+}
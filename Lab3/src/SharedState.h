@@ -0,0 +1,42 @@
+#ifndef SHARED_STATE_H
+#define SHARED_STATE_H
+
+#include <atomic>
+#include <cstdint>
+#include "CacheLine.h"
+
+// Everything a monitor wants to see at once, read as one consistent view.
+struct TimerState {
+    int counter;
+    bool leader_present;
+    std::uint32_t leader_pid;      // 0 while there is no leader
+    std::int64_t last_update_ns;   // wall clock time of the last change
+};
+
+// Seqlock over a copy of the instance state. Writers are serialized by the
+// counter lock and make the sequence odd while they update the fields;
+// readers never write shared memory, they retry when the sequence was odd
+// or moved while they copied, so any number of them cannot slow a writer.
+// The fields are relaxed atomics, which keeps the concurrent copy defined.
+struct alignas(CACHE_LINE_SIZE) StateBlock {
+    std::atomic<std::uint32_t> sequence;
+    std::atomic<std::int32_t> counter;
+    std::atomic<std::uint32_t> leader_pid;
+    std::atomic<std::uint32_t> leader_present;
+    std::atomic<std::int64_t> last_update_ns;
+};
+
+void init_state_block(StateBlock* block);
+
+// Writer side, call with the counter lock held.
+void publish_counter_state(StateBlock* block, int counter);
+void publish_leader_state(StateBlock* block, bool leader_present, std::uint32_t leader_pid);
+
+// Ends an update left half done by a writer that died holding the counter
+// lock. Call with the lock held, then publish the fields again.
+void repair_state_block(StateBlock* block);
+
+// Lock-free consistent snapshot of all fields.
+TimerState read_state_snapshot(const StateBlock* block);
+
+#endif
@@ -1,5 +1,4 @@
 #include <iostream>
-#include <fstream>
 #include <thread>
 #include <chrono>
 #include <mutex>
@@ -7,134 +6,96 @@
 #include <string>
 #include <ctime>
 #include <cstdlib>
+#include <cstdio>
 #include <vector>
 #include <filesystem>
+#include "SharedSegment.h"
+#include "LogWriter.h"
+#include "Options.h"
+#include "Scheduler.h"
+#include "RtTicker.h"
+#include "ChildReaper.h"
+#include "ChildScript.h"
+#include "ControlServer.h"
+#include "CounterWatch.h"
+#include "TimestampFormatter.h"
 
 #ifdef _WIN32
 #include <windows.h>
-HANDLE log_mutex;
 HANDLE counter_mutex;
 #else
 #include <sys/wait.h>
-#include <sys/mman.h>
-#include <fcntl.h>
 #include <unistd.h>
 #include <cstring>
 #include <csignal>
-#include <semaphore.h>
-sem_t* log_semaphore;
-sem_t* counter_semaphore;
+#include <cerrno>
+#include <pthread.h>
 #endif
 
 // Shared variables in shared memory
+SharedSegment* shared_segment = nullptr;
 std::atomic<int>* shared_counter = nullptr;
 std::atomic<bool>* is_leader = nullptr;
 
+// This instance's entry in the shared instance registry, nullptr in copies
+InstanceSlot* instance_slot = nullptr;
+
 // Local atomic flags
 std::atomic<bool> is_leader_instance(false);
-std::atomic<bool> copy1_running(false);
-std::atomic<bool> copy2_running(false);
+std::atomic<int> running_children(0);
 std::atomic<bool> stop_flag(false);
 
 // Thread management
 std::vector<std::thread> threads;
-std::ofstream log_file;
 
+// Periodic tasks, all run on the scheduler thread
+Scheduler scheduler;
+Scheduler::TaskId leader_check_task_id = 0;
+const auto COUNTER_INCREMENT_PERIOD = std::chrono::milliseconds(300);
+const auto COUNTER_LOG_PERIOD = std::chrono::seconds(1);
+const auto SPAWN_PERIOD = std::chrono::seconds(3);
+const auto LEADER_CHECK_PERIOD = std::chrono::milliseconds(20);
+const auto SCHEDULER_REPORT_PERIOD = std::chrono::minutes(1);
+const auto HISTOGRAM_DUMP_CHECK_PERIOD = std::chrono::milliseconds(250);
+const auto CHILD_STATS_PERIOD = std::chrono::seconds(10);
+const auto HEARTBEAT_PERIOD = std::chrono::seconds(1);
+const auto WATCH_WAIT_TIMEOUT = std::chrono::milliseconds(60 * 1000);
+
+// Set from the SIGUSR1 handler, the histogram is printed by a scheduler task
+std::atomic<bool> histogram_dump_requested(false);
+
+TimerOptions options;
+
+// Operations of the copies, copy N runs child_scripts[N - 1]
+std::vector<ChildScript> child_scripts;
+
+// Leader-side totals of finished copies, reported by child_stats_task
+std::atomic<std::uint64_t> children_finished(0);
+std::atomic<std::uint64_t> child_ops_done(0);
+std::atomic<std::int64_t> child_time_ns(0);
 
-// Sets up shared memory for the counter and leader flag.
 
+// Sets up shared memory for the counter and leader flag.
 void setup_shared_memory() {
-#ifdef _WIN32
-    HANDLE hMapFile = OpenFileMappingA(FILE_MAP_ALL_ACCESS, FALSE, "SharedCounter");
-    if (hMapFile == NULL) { // leader instance, creating variables
-        hMapFile = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 0, sizeof(std::atomic<int>) + sizeof(std::atomic<bool>), "SharedCounter");
-        if (hMapFile == NULL) {
-            std::cerr << "Could not create file mapping object: " << GetLastError() << std::endl;
-            exit(1);
-        }
-        void* base_address = MapViewOfFile(hMapFile, FILE_MAP_ALL_ACCESS, 0, 0, sizeof(std::atomic<int>) + sizeof(std::atomic<bool>));
-        shared_counter = new (base_address) std::atomic<int>(0);
-        is_leader = new (reinterpret_cast<void*>(reinterpret_cast<char*>(base_address) + sizeof(std::atomic<int>))) std::atomic<bool>(true);
-        if (!shared_counter || !is_leader) {
-            std::cerr << "Could not map view of file: " << GetLastError() << std::endl;
-            CloseHandle(hMapFile);
-            exit(1);
-        }
-        is_leader_instance = true;
-    } else { // additional instance
-        void* base_address = MapViewOfFile(hMapFile, FILE_MAP_ALL_ACCESS, 0, 0, sizeof(std::atomic<int>) + sizeof(std::atomic<bool>));
-        shared_counter = reinterpret_cast<std::atomic<int>*>(base_address);
-        is_leader = reinterpret_cast<std::atomic<bool>*>(reinterpret_cast<char*>(base_address) + sizeof(std::atomic<int>));
-        if (!shared_counter || !is_leader) {
-            std::cerr << "Could not map view of file: " << GetLastError() << std::endl;
-            CloseHandle(hMapFile);
-            exit(1);
-        }
-    }
-#else
-    const char* shared_memory_name = "/SharedCounter";
-    const size_t memory_size = sizeof(std::atomic<int>) + sizeof(std::atomic<bool>);
-    int fd = shm_open(shared_memory_name, O_RDWR, 0666);
-
-    if (fd == -1) { // leader instance, creating variables
-        fd = shm_open(shared_memory_name, O_CREAT | O_RDWR, 0666);
-        if (fd == -1) {
-            perror("Could not create shared memory");
-            exit(1);
-        }
-        if (ftruncate(fd, memory_size) == -1) {
-            perror("Could not set size for shared memory");
-            shm_unlink(shared_memory_name);
-            exit(1);
-        }
-        void* addr = mmap(nullptr, memory_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
-        if (addr == MAP_FAILED) {
-            perror("Could not map shared memory");
-            shm_unlink(shared_memory_name);
-            exit(1);
-        }
-        shared_counter = new (addr) std::atomic<int>(0);
-        is_leader = new (reinterpret_cast<void*>(reinterpret_cast<char*>(addr) + sizeof(std::atomic<int>))) std::atomic<bool>(true);
+    bool created = false;
+    shared_segment = attach_shared_segment(created, options.persist_path);
+    shared_counter = &shared_segment->counter;
+    is_leader = &shared_segment->leader;
+    if (created) { // leader instance, variables are initialized
         is_leader_instance = true;
-    } else { // additional instance
-        void* addr = mmap(nullptr, memory_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
-        if (addr == MAP_FAILED) {
-            perror("Could not map shared memory");
-            exit(1);
-        }
-        shared_counter = reinterpret_cast<std::atomic<int>*>(addr);
-        is_leader = reinterpret_cast<std::atomic<bool>*>(reinterpret_cast<char*>(addr) + sizeof(std::atomic<int>));
     }
-
-    close(fd);
-#endif
 }
 
 
-// Sets up synchronization mechanisms for logging.
-void setup_log_synchronization() {
+// Sets up synchronization mechanisms for the counter. On other platforms
+// the lock lives in the shared segment (SharedSegment::counter_lock).
+void setup_counter_synchronization() {
 #ifdef _WIN32
-    log_mutex = CreateMutexA(NULL, FALSE, "GlobalLogMutex");
-    if (!log_mutex) {
-        std::cerr << "Failed to create log mutex." << std::endl;
-        exit(1);
-    }
     counter_mutex = CreateMutexA(NULL, FALSE, "GlobalCounterMutex");
     if (!counter_mutex) {
         std::cerr << "Failed to create counter mutex." << std::endl;
         exit(1);
     }
-#else
-    log_semaphore = sem_open("/log_semaphore", O_CREAT, 0644, 1);
-    if (log_semaphore == SEM_FAILED) {
-        std::cerr << "Failed to create log semaphore." << std::endl;
-        exit(1);
-    }
-    counter_semaphore = sem_open("/counter_semaphore", O_CREAT, 0644, 1);
-    if (counter_semaphore == SEM_FAILED) {
-        std::cerr << "Failed to create counter semaphore." << std::endl;
-        exit(1);
-    }
 #endif
 }
 
@@ -142,30 +103,16 @@ void setup_log_synchronization() {
 //Cleans up shared memory resources.
 
 void cleanup_shared_memory() {
-#ifdef _WIN32
-    if (shared_counter || is_leader) {
-        UnmapViewOfFile(shared_counter);
-        UnmapViewOfFile(is_leader);
-    }
-#else
-    if (shared_counter || is_leader) {
-        munmap(shared_counter, sizeof(std::atomic<int>) + sizeof(std::atomic<bool>));
-    }
-    shm_unlink("/SharedCounter");
-#endif
+    detach_shared_segment(shared_segment);
+    shared_segment = nullptr;
+    remove_shared_segment();
 }
 
 
- // Cleans up synchronization resources for logging.
-void cleanup_log_synchronization() {
+ // Cleans up synchronization resources for the counter.
+void cleanup_counter_synchronization() {
 #ifdef _WIN32
-    CloseHandle(log_mutex);
     CloseHandle(counter_mutex);
-#else
-    sem_close(log_semaphore);
-    sem_unlink("/log_semaphore");
-    sem_close(counter_semaphore);
-    sem_unlink("/counter_semaphore");
 #endif
 }
 
@@ -174,6 +121,13 @@ void cleanup_log_synchronization() {
 void terminate_threads() {
     std::cout << "Terminate threads...\n";
     stop_flag = true;
+    scheduler.stop();
+    if (options.rt_tick_ms > 0) {
+        stop_rt_ticker();
+        rt_tick_histogram().print(std::cout, "RT tick lateness");
+    }
+
+    stop_child_reaper();
 
     for (auto& t : threads) {
         if (t.joinable()) {
@@ -185,60 +139,111 @@ void terminate_threads() {
 }
 
 
-// Utility function to get current time
-std::string get_current_time() {
-    auto now = std::chrono::system_clock::now();
-    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch()) % 1000;
-    std::time_t t = std::chrono::system_clock::to_time_t(now);
-    std::tm tm = *std::localtime(&t);
+std::uint32_t current_process_id() {
+#ifdef _WIN32
+    return static_cast<std::uint32_t>(GetCurrentProcessId());
+#else
+    return static_cast<std::uint32_t>(getpid());
+#endif
+}
 
-    char buffer[30];
-    strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S", &tm);
 
-    return std::string(buffer) + "." + std::to_string(ms.count());
+// Logs a structured event. The record is queued in the shared log ring and
+// written to the log file by the leader's writer thread (see LogEvents.cpp).
+void log_event(LogEvent event, std::int64_t payload = 0) {
+    log_ring_push(&shared_segment->log_ring, event, payload);
+    if (instance_slot) {
+        instance_slot->log_lines.fetch_add(1, std::memory_order_relaxed);
+    }
 }
 
-
-// Logs a message with a timestamp.
+// Logs a free-form message.
 void log_message(const std::string& message) {
+    log_ring_push(&shared_segment->log_ring, EVENT_TEXT, 0, message.data(), message.size());
+    if (instance_slot) {
+        instance_slot->log_lines.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+// A holder that died (a copy killed in the middle of an operation) does not
+// block the others: the mutex is handed to the next waiter, which finishes
+// the state block update the holder may have left open. The counter itself
+// is a single store, it holds either the old or the new value.
+void lock_counter() {
 #ifdef _WIN32
-    WaitForSingleObject(log_mutex, INFINITE);
+    WaitForSingleObject(counter_mutex, INFINITE);
 #else
-    sem_wait(log_semaphore);
+    if (pthread_mutex_lock(&shared_segment->counter_lock) == EOWNERDEAD) {
+        repair_state_block(&shared_segment->state);
+        publish_counter_state(&shared_segment->state, shared_counter->load());
+        pthread_mutex_consistent(&shared_segment->counter_lock);
+        log_message("Counter lock taken over from a process that died holding it.");
+    }
 #endif
+}
 
-    log_file << get_current_time() << " - " << message << std::endl;
-    log_file.flush();
-
+void unlock_counter() {
 #ifdef _WIN32
-    ReleaseMutex(log_mutex);
+    ReleaseMutex(counter_mutex);
 #else
-    sem_post(log_semaphore);
+    pthread_mutex_unlock(&shared_segment->counter_lock);
 #endif
 }
 
 // Sets counter
 void safe_set_counter(int value) {
-#ifdef _WIN32
-    WaitForSingleObject(counter_mutex, INFINITE);
-#else
-    sem_wait(counter_semaphore);
-#endif
-
+    lock_counter();
     (*shared_counter) = value;  
+    publish_counter_state(&shared_segment->state, value);
+    unlock_counter();
+    publish_counter_change(shared_segment);
+    if (instance_slot) {
+        instance_slot->ops.fetch_add(1, std::memory_order_relaxed);
+    }
+}
 
-#ifdef _WIN32
-    ReleaseMutex(counter_mutex);
-#else
-    sem_post(counter_semaphore);
-#endif
+// Read-modify-write of the counter under the lock, so concurrent updates
+// from other instances and copies are never lost. Returns the new value.
+template <typename Update>
+int safe_update_counter(Update update) {
+    lock_counter();
+    int value = update(shared_counter->load());
+    (*shared_counter) = value;
+    publish_counter_state(&shared_segment->state, value);
+    unlock_counter();
+    publish_counter_change(shared_segment);
+    if (instance_slot) {
+        instance_slot->ops.fetch_add(1, std::memory_order_relaxed);
+    }
+    return value;
 }
 
 
 // Function to handle program exit
 void on_exit() {
+    // Runs from the signal handler and again from atexit inside exit(),
+    // the segment is already unmapped the second time.
+    static std::atomic<bool> exiting(false);
+    if (exiting.exchange(true)) {
+        return;
+    }
+
+    // Periodic work touches the segment, it has to end before it is unmapped.
+    scheduler.stop();
+    stop_rt_ticker();
+    stop_control_server();
+    release_instance_slot(instance_slot);
+    instance_slot = nullptr;
 
     if (is_leader_instance) {
+        stop_log_writer();
+
+        lock_counter();
+        publish_leader_state(&shared_segment->state, false, 0);
+        unlock_counter();
+
+        persist_counter(shared_segment);
+
         std::cout << "Releasing leader flag...\n";
         is_leader->store(false, std::memory_order_release);
         auto start_time = std::chrono::steady_clock::now();
@@ -250,7 +255,7 @@ void on_exit() {
         }
 
         if (!is_leader->load(std::memory_order_acquire)) {
-            cleanup_log_synchronization();
+            cleanup_counter_synchronization();
             cleanup_shared_memory();
         }
     }
@@ -260,38 +265,48 @@ void on_exit() {
     exit(0);
 }
 
+void child_instance_behavior(int id);
+
+#ifndef _WIN32
+// Body of a forked child. The shared segment, the counter lock and the
+// log ring are inherited from the leader, so nothing is set up again. Only
+// the forking thread exists here: signal dispositions and the mask are reset
+// to what a freshly started process has, and _exit() skips the leader's
+// atexit cleanup.
+[[noreturn]] void run_forked_child(int id) {
+    std::signal(SIGINT, SIG_DFL);
+    std::signal(SIGHUP, SIG_DFL);
+    std::signal(SIGTERM, SIG_DFL);
+    std::signal(SIGUSR1, SIG_DFL);
+    sigset_t no_signals;
+    sigemptyset(&no_signals);
+    pthread_sigmask(SIG_SETMASK, &no_signals, nullptr);
+
+    set_log_process_id(current_process_id());
+    instance_slot = nullptr;
+    child_instance_behavior(id);
+    _exit(0);
+}
+#endif
+
 // Function to handle spawning childs
 void spawn_child_process(int id) {
 #ifdef _WIN32
     STARTUPINFOA si = { sizeof(STARTUPINFOA) };
     PROCESS_INFORMATION pi = {};
     si.cb = sizeof(si);
-    std::string command = "Timer.exe " + std::to_string(id); 
+    std::string command = "Timer.exe " + std::to_string(id);
+    if (!options.child_config.empty()) {
+        command += " \"--child-config=" + options.child_config + "\"";
+    }
     if (!CreateProcessA(NULL, const_cast<char*>(command.c_str()), NULL, NULL, FALSE, 0, NULL, NULL, &si, &pi)) {
         log_message("Failed to create child process.");
         return;
     }
 
-    if (id == 1) {
-        copy1_running = true;
-    } else if (id == 2) {
-        copy2_running = true;
-    }
-
-    std::thread child([pi, id]() {
-        WaitForSingleObject(pi.hProcess, INFINITE);
-        CloseHandle(pi.hProcess);
-        CloseHandle(pi.hThread);
-
-        if (id == 1) {
-            copy1_running = false;
-        } else if (id == 2) {
-            copy2_running = false;
-        }
-    });
-    threads.push_back(std::move(child));
+    CloseHandle(pi.hThread);
+    ChildHandle child = pi.hProcess;
 #else
-    std::string command = "./Timer " + std::to_string(id);
     pid_t pid = fork();
     if (pid < 0) {
         log_message("Failed to fork child process.");
@@ -299,52 +314,118 @@ void spawn_child_process(int id) {
     }
 
     if (pid == 0) {
-        // Child process
-        execlp("sh", "sh", "-c", command.c_str(), (char*)NULL);
-        log_message("Failed to execute child process.");
-        std::exit(1);
-    } else {
-        // Parent process
-        if (id == 1) {
-            copy1_running = true;
-        } else if (id == 2) {
-            copy2_running = true;
+        run_forked_child(id);
+    }
+    ChildHandle child = pid;
+#endif
+
+    running_children++;
+    if (instance_slot) {
+        instance_slot->children_spawned.fetch_add(1, std::memory_order_relaxed);
+    }
+    std::int64_t started_ns = monotonic_ns();
+    std::size_t ops = counter_op_count(child_scripts[id - 1]);
+
+    watch_child(child, [started_ns, ops](int status) {
+        children_finished++;
+        child_time_ns += monotonic_ns() - started_ns;
+#ifdef _WIN32
+        bool completed = status == 0;
+#else
+        bool completed = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+#endif
+        if (completed) {
+            child_ops_done += ops;
         }
+        running_children--;
+    });
+}
 
-        std::thread child([pid, id]() {
-            int status;
-            waitpid(pid, &status, 0);
 
-            if (id == 1) {
-                copy1_running = false;
-            } else if (id == 2) {
-                copy2_running = false;
-            }
-        });
-        threads.push_back(std::move(child));
+// Task for logging
+void log_counter_task() {
+    log_event(EVENT_COUNTER_VALUE, *shared_counter);
+}
+
+
+// Task for counter increment
+void counter_increment_task() {
+    safe_update_counter([](int value) { return value + 1; });
+}
+
+
+// Task for spawning children
+// Starts child_fanout copies, cycling through the scripts. A cycle that
+// would run more than max_children copies at once is skipped as a whole.
+void spawn_children_task() {
+    int fanout = options.child_fanout > 0 ? options.child_fanout : static_cast<int>(child_scripts.size());
+    int max_children = options.max_children > 0 ? options.max_children : fanout;
+
+    if (running_children + fanout <= max_children) {
+        log_event(EVENT_SPAWN_STARTED);
+
+        for (int i = 0; i < fanout; ++i) {
+            spawn_child_process(i % static_cast<int>(child_scripts.size()) + 1);
+        }
+    } else {
+        log_event(EVENT_SPAWN_SKIPPED);
     }
-#endif
 }
 
 
-// Thread for logging
-void log_counter_thread() {
-    while (!stop_flag) {
-        std::this_thread::sleep_for(std::chrono::seconds(1));
-        log_message("Main instance log: Counter value: " + std::to_string((*shared_counter)));
+// Task that logs how many copies finished, their counter operations per
+// second and the mean time from spawn to reap since the previous report
+void child_stats_task() {
+    static std::uint64_t last_finished = 0;
+    static std::uint64_t last_ops = 0;
+    static std::int64_t last_time_ns = 0;
+
+    std::uint64_t finished = children_finished - last_finished;
+    std::uint64_t ops = child_ops_done - last_ops;
+    std::int64_t time_ns = child_time_ns - last_time_ns;
+    last_finished += finished;
+    last_ops += ops;
+    last_time_ns += time_ns;
+
+    if (finished == 0 && running_children == 0) {
+        return;
     }
+    double seconds = std::chrono::duration<double>(CHILD_STATS_PERIOD).count();
+    double mean_ms = finished > 0 ? time_ns / 1e6 / static_cast<double>(finished) : 0.0;
+    char message[160];
+    snprintf(message, sizeof(message), "Child stats: %llu finished, %d running, %.1f ops/s, mean time in child %.3f ms",
+             static_cast<unsigned long long>(finished), running_children.load(), ops / seconds, mean_ms);
+    log_message(message);
 }
 
 
-//Thread for counter increment
-void counter_increment_thread() {
-    while (!stop_flag) {
-        std::this_thread::sleep_for(std::chrono::milliseconds(300));
-        safe_set_counter((*shared_counter) + 1);
+// Task that prints the RT tick lateness histogram when it was requested
+void histogram_dump_task() {
+    if (!histogram_dump_requested.exchange(false)) {
+        return;
     }
+    const LatencyHistogram& histogram = rt_tick_histogram();
+    histogram.print(std::cout, "RT tick lateness");
+    log_message("RT tick lateness: count " + std::to_string(histogram.count()) +
+                ", p50 " + std::to_string(histogram.value_at_percentile(50) / 1000) + " us" +
+                ", p99 " + std::to_string(histogram.value_at_percentile(99) / 1000) + " us" +
+                ", p99.99 " + std::to_string(histogram.value_at_percentile(99.99) / 1000) + " us" +
+                ", max " + std::to_string(histogram.max() / 1000) + " us");
 }
 
-// Thread for user input
+
+// Task that logs how late every periodic task runs
+void scheduler_report_task() {
+    for (const auto& task : scheduler.stats()) {
+        log_message("Scheduler task " + task.name + ": runs " + std::to_string(task.runs) +
+                    ", mean lateness " + std::to_string(task.mean_lateness_ns / 1000) + " us" +
+                    ", max lateness " + std::to_string(task.max_lateness_ns / 1000) + " us" +
+                    ", missed " + std::to_string(task.missed));
+    }
+}
+
+#ifdef _WIN32
+// Thread for user input. Other platforms are controlled through timerctl.
 void user_input_thread() {
     while (!stop_flag) {
         std::string input;
@@ -359,7 +440,7 @@ void user_input_thread() {
             try {
                 int value = std::stoi(input.substr(4)); 
                 safe_set_counter(value);
-                log_message("Counter set to: " + std::to_string(value));
+                log_event(EVENT_COUNTER_SET, value);
                 std::cout << "Counter set to: " << value << std::endl;
             } catch (...) {
                 std::cout << "Invalid command. Use: set <value>" << std::endl;
@@ -372,72 +453,160 @@ void user_input_thread() {
         }
     }
 }
+#endif
 
-void child_instance_behavior(int id, pid_t child_pid){
-    std::string start_message = "Child process " + std::to_string(id) + " started. PID: " + std::to_string(child_pid);
-    log_message(start_message);
-    
-    if (id == 1) {
-        safe_set_counter((*shared_counter) + 10);
-        log_message("Child 1 incremented counter by 10. Exiting.");
-    } else if (id == 2) {
-        safe_set_counter((*shared_counter) * 2);
-        log_message("Child 2 doubled counter. Sleeping for 2 seconds.");
-        std::this_thread::sleep_for(std::chrono::seconds(2));
-        safe_set_counter((*shared_counter) / 2);
-        log_message("Child 2 halved counter. Exiting.");
-    }
-
-    std::string end_message = "Child process " + std::to_string(id) + " exiting. PID: " + std::to_string(child_pid);
-    log_message(end_message);
+// "key=value ..." line answered to the control socket's stats request
+std::string control_stats() {
+    TimerState state = read_state_snapshot(&shared_segment->state);
+    long long age_ms = (TimestampFormatter::now_ns() - state.last_update_ns) / 1000000;
+    char stats[320];
+    snprintf(stats, sizeof(stats),
+             "counter=%d leader=%d leader_pid=%u last_update_age_ms=%lld running_children=%d "
+             "children_finished=%llu child_ops=%llu log_dropped=%llu",
+             state.counter, state.leader_present ? 1 : 0, static_cast<unsigned>(state.leader_pid), age_ms,
+             running_children.load(), static_cast<unsigned long long>(children_finished.load()),
+             static_cast<unsigned long long>(child_ops_done.load()),
+             static_cast<unsigned long long>(shared_segment->log_ring.dropped.load()));
+    return stats;
 }
 
-void additional_instance_behavior(){
-    std::cout << "This is additional instance, affects only counter" << std::endl;
-    while (!is_leader_instance) {
-        if (!is_leader->load(std::memory_order_acquire)) {
-            is_leader->store(true, std::memory_order_release);
-            is_leader_instance = true;
+void start_control_socket() {
+    ControlHandlers handlers;
+    handlers.get = []() { return shared_counter->load(); };
+    handlers.set = [](int value) {
+        safe_set_counter(value);
+        log_event(EVENT_COUNTER_SET, value);
+        return value;
+    };
+    handlers.add = [](int delta) {
+        return safe_update_counter([delta](int value) {
+            return static_cast<int>(static_cast<unsigned int>(value) + static_cast<unsigned int>(delta));
+        });
+    };
+    handlers.stats = control_stats;
+    handlers.get_named = [](const std::string& name, std::int64_t& value) {
+        return named_counter_get(&shared_segment->named_counters, name, value);
+    };
+    handlers.set_named = [](const std::string& name, std::int64_t value) {
+        return named_counter_set(&shared_segment->named_counters, name, value);
+    };
+    handlers.add_named = [](const std::string& name, std::int64_t delta, std::int64_t& value) {
+        return named_counter_add(&shared_segment->named_counters, name, delta, value);
+    };
+    handlers.list_named = []() {
+        std::string result;
+        for (const auto& counter : list_named_counters(&shared_segment->named_counters)) {
+            result += (result.empty() ? "" : " ") + counter.first + "=" + std::to_string(counter.second);
         }
+        return result;
+    };
+    handlers.wait_for_change = [](std::uint32_t sequence) {
+        return wait_for_change(shared_segment, sequence, WATCH_WAIT_TIMEOUT,
+                               std::chrono::milliseconds(options.watch_coalesce_ms));
+    };
+    handlers.wake_change_waiters = []() { wake_change_waiters(shared_segment); };
+    if (start_control_server(options.control_socket, std::move(handlers))) {
+        std::cout << "Control socket: " << options.control_socket << std::endl;
     }
-    std::cout << "Leader instance was closed" << std::endl;
 }
 
-void leader_instance_behavior(){
-    std::cout << "This instance is leader" << std::endl;
+void child_instance_behavior(int id){
+    log_event(EVENT_CHILD_STARTED, id);
 
-    std::thread log_counter(log_counter_thread);
-    threads.push_back(std::move(log_counter));
+    for (const ChildOp& op : child_scripts[id - 1]) {
+        if (op.kind == ChildOpKind::Sleep) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(op.value));
+            continue;
+        }
+        int value = safe_update_counter([&op](int current) { return apply_child_op(op, current); });
+        std::string text = describe_child_op(op);
+        log_ring_push(&shared_segment->log_ring, EVENT_CHILD_OP, value, text.data(), text.size());
+    }
 
-    while (true) {
-        std::this_thread::sleep_for(std::chrono::seconds(3));
+    log_event(EVENT_CHILD_EXITING, id);
+}
 
-        if (!copy1_running && !copy2_running) {
-            log_message("Spawning child processes.");
+void leader_instance_behavior(){
+    std::cout << "This instance is leader" << std::endl;
+    lock_counter();
+    publish_leader_state(&shared_segment->state, true, current_process_id());
+    unlock_counter();
+    if (instance_slot) {
+        instance_slot->role.store(ROLE_LEADER, std::memory_order_relaxed);
+    }
+    start_child_reaper();
 
-            spawn_child_process(1);
-            spawn_child_process(2);
-        } else {
-            log_message("Child processes still running. Skipping spawn.");
-        }
+    if (!start_log_writer(&shared_segment->log_ring, log_file_path(options), options.log_format,
+                          options.log_sync, options.log_rotation)) {
+        std::cerr << "Failed to open log file." << std::endl;
+        exit(1);
+    }
 
+    scheduler.add_periodic("counter_log", COUNTER_LOG_PERIOD, log_counter_task);
+    scheduler.add_periodic("spawn_children", SPAWN_PERIOD, spawn_children_task);
+    scheduler.add_periodic("child_stats", CHILD_STATS_PERIOD, child_stats_task);
+    scheduler.add_periodic("scheduler_report", SCHEDULER_REPORT_PERIOD, scheduler_report_task);
+    if (!options.persist_path.empty()) {
+        scheduler.add_periodic("persist_counter", std::chrono::milliseconds(options.persist_interval_ms),
+                               []() { persist_counter(shared_segment); });
     }
+    start_control_socket();
+}
+
+// Task of additional instances, takes the leader flag once it is released
+void leader_check_task() {
+    bool expected = false;
+    if (is_leader->compare_exchange_strong(expected, true, std::memory_order_acq_rel)) {
+        is_leader_instance = true;
+        scheduler.remove(leader_check_task_id);
+        std::cout << "Leader instance was closed" << std::endl;
+        leader_instance_behavior();
+    }
+}
+
+void additional_instance_behavior(){
+    std::cout << "This is additional instance, affects only counter" << std::endl;
+    leader_check_task_id = scheduler.add_periodic("leader_check", LEADER_CHECK_PERIOD, leader_check_task);
 }
 
 void parent_instance_behavior() {
+#ifndef _WIN32
+    // Threads started from here inherit the mask, so exit signals are
+    // handled on the main thread only.
+    sigset_t exit_signals;
+    sigemptyset(&exit_signals);
+    sigaddset(&exit_signals, SIGINT);
+    sigaddset(&exit_signals, SIGHUP);
+    sigaddset(&exit_signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &exit_signals, nullptr);
+#endif
 
+#ifdef _WIN32
     std::thread user_input(user_input_thread);
     threads.push_back(std::move(user_input));
+#endif
 
-    std::thread counter_increment(counter_increment_thread);
-    threads.push_back(std::move(counter_increment));
+    if (options.rt_tick_ms > 0) {
+        start_rt_ticker({ std::chrono::milliseconds(options.rt_tick_ms), options.rt_cpu, options.rt_priority },
+                        counter_increment_task);
+        scheduler.add_periodic("histogram_dump", HISTOGRAM_DUMP_CHECK_PERIOD, histogram_dump_task);
+    } else {
+        scheduler.add_periodic("counter_increment", COUNTER_INCREMENT_PERIOD, counter_increment_task);
+    }
+    scheduler.add_periodic("heartbeat", HEARTBEAT_PERIOD, []() { instance_heartbeat(instance_slot); });
+    if (is_leader_instance) {
+        leader_instance_behavior();
+    } else {
+        additional_instance_behavior();
+    }
+    scheduler.start();
 
-    while(true) {
-        if (is_leader_instance) {
-            leader_instance_behavior();
-        } else {
-            additional_instance_behavior();
-        }
+#ifndef _WIN32
+    pthread_sigmask(SIG_UNBLOCK, &exit_signals, nullptr);
+#endif
+
+    while (!stop_flag) {
+        std::this_thread::sleep_for(std::chrono::seconds(1));
     }
 }
 
@@ -450,6 +619,10 @@ void parent_instance_behavior() {
         return FALSE;
     }
 #else
+    void dumpSignalHandler(int) {
+        histogram_dump_requested = true;
+    }
+
     void signalHandler(int signal) {
         if (signal == SIGHUP || signal == SIGINT || signal == SIGTERM) {
             on_exit();
@@ -459,27 +632,30 @@ void parent_instance_behavior() {
 #endif
 
 int main(int argc, char* argv[]) {
+    options = parse_options(argc, argv);
+
+    child_scripts = default_child_scripts();
+    if (!options.child_config.empty()) {
+        std::string error;
+        if (!load_child_scripts(options.child_config, child_scripts, error)) {
+            std::cerr << "Invalid child config: " << error << std::endl;
+            exit(1);
+        }
+    }
+    check_child_limits(argv[0], options, child_scripts.size());
+
     setup_shared_memory();
-    setup_log_synchronization();
+    setup_counter_synchronization();
 
-    auto pid =
-#ifdef _WIN32
-        GetCurrentProcessId();
-#else
-        getpid();
-#endif
+    set_log_process_id(current_process_id());
 
     std::filesystem::create_directories("../logs");
-    log_file.open("../logs/timer.log", std::ios::app);
-    if (!log_file.is_open()) {
-        std::cerr << "Failed to open log file." << std::endl;
-        cleanup_log_synchronization();
-        return 1;
-    }
-
-    if (argc > 1) {
-        int id = std::stoi(argv[1]);
-        child_instance_behavior(id, pid);
+    if (options.child_id != 0) {
+        if (options.child_id > static_cast<int>(child_scripts.size())) {
+            std::cerr << "No script for child " << options.child_id << std::endl;
+            return 1;
+        }
+        child_instance_behavior(options.child_id);
         return 0;
     }
 
@@ -489,10 +665,17 @@ int main(int argc, char* argv[]) {
     std::signal(SIGINT, signalHandler);
     std::signal(SIGHUP, signalHandler);
     std::signal(SIGTERM, signalHandler);
+    std::signal(SIGUSR1, dumpSignalHandler);
     std::atexit(on_exit);
 #endif
 
-    log_message("Program started. PID: " + std::to_string(pid));
+    instance_slot = claim_instance_slot(&shared_segment->registry, current_process_id(),
+                                        is_leader_instance ? ROLE_LEADER : ROLE_ADDITIONAL);
+    if (!instance_slot) {
+        std::cerr << "Instance registry is full, this instance is not listed." << std::endl;
+    }
+
+    log_event(EVENT_PROGRAM_STARTED);
 
     parent_instance_behavior();
 
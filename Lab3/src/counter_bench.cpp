@@ -0,0 +1,328 @@
+// counter_bench - measures how the shared counter scales with the number of
+// processes updating it, for every synchronization primitive Timer could use.
+//
+//     counter_bench [--processes=1,2,4] [--duration=MS] [--primitives=sem,cas]
+//
+// One CSV row per primitive and process count goes to stdout.
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <new>
+#include <cstdint>
+#include <cstdlib>
+#include <cstdio>
+#include <ctime>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include "CacheLine.h"
+#include "LatencyHistogram.h"
+
+namespace {
+
+constexpr int MAX_PROCESSES = 64;
+
+enum Primitive {
+    PRIMITIVE_SEM,       // what Timer does today: sem_wait/sem_post around a plain store
+    PRIMITIVE_MUTEX,     // process-shared pthread mutex around a plain store
+    PRIMITIVE_FETCH_ADD, // one atomic fetch_add
+    PRIMITIVE_CAS,       // load + compare_exchange retry loop
+    PRIMITIVE_SHARDED,   // fetch_add on the process' own cache line, summed by readers
+    PRIMITIVE_COUNT
+};
+
+const char* const PRIMITIVE_NAMES[PRIMITIVE_COUNT] = { "sem", "mutex", "fetch_add", "cas", "sharded" };
+
+struct alignas(CACHE_LINE_SIZE) Shard {
+    std::atomic<std::int64_t> value;
+};
+
+// Shared between the parent and all workers of one run, mapped anonymously
+// before fork(). Every field written by several processes has its own line.
+struct BenchArena {
+    alignas(CACHE_LINE_SIZE) std::atomic<std::int64_t> counter;
+    alignas(CACHE_LINE_SIZE) std::int64_t locked_counter;
+    alignas(CACHE_LINE_SIZE) sem_t semaphore;
+    alignas(CACHE_LINE_SIZE) pthread_mutex_t mutex;
+    alignas(CACHE_LINE_SIZE) std::atomic<int> ready;
+    alignas(CACHE_LINE_SIZE) std::atomic<bool> go;
+    alignas(CACHE_LINE_SIZE) std::atomic<bool> stop;
+    Shard shards[MAX_PROCESSES];
+    Shard ops[MAX_PROCESSES];
+    LatencyHistogram latency[MAX_PROCESSES];
+};
+
+struct BenchOptions {
+    std::vector<int> processes = { 1, 2, 4, 8, 16, 32, 64 };
+    std::vector<Primitive> primitives = { PRIMITIVE_SEM, PRIMITIVE_MUTEX, PRIMITIVE_FETCH_ADD,
+                                          PRIMITIVE_CAS, PRIMITIVE_SHARDED };
+    int duration_ms = 1000;
+};
+
+void print_usage(const char* program) {
+    std::cerr << "Usage: " << program << " [options]\n"
+              << "Options:\n"
+              << "  --processes=N[,N...]    process counts to run, 1.." << MAX_PROCESSES
+              << " (default 1,2,4,8,16,32,64)\n"
+              << "  --duration=MS           length of every run (default 1000)\n"
+              << "  --primitives=name[,...] sem, mutex, fetch_add, cas, sharded (default all)\n"
+              << "Prints CSV: primitive,processes,ops,seconds,ops_per_sec,mean_ns,p50_ns,p99_ns,p999_ns,max_ns\n"
+              << "Latency is measured around every update and includes the clock read.\n";
+}
+
+[[noreturn]] void usage_error(const char* program, const std::string& message) {
+    std::cerr << message << std::endl;
+    print_usage(program);
+    exit(1);
+}
+
+std::vector<std::string> split_list(const std::string& value) {
+    std::vector<std::string> items;
+    std::stringstream stream(value);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        items.push_back(item);
+    }
+    return items;
+}
+
+int parse_int(const char* program, const std::string& name, const std::string& value, int min, int max) {
+    try {
+        std::size_t used = 0;
+        int result = std::stoi(value, &used);
+        if (used == value.size() && result >= min && result <= max) {
+            return result;
+        }
+    } catch (const std::exception&) {
+    }
+    usage_error(program, name + " must be a number from " + std::to_string(min) + " to " + std::to_string(max));
+}
+
+BenchOptions parse_options(int argc, char* argv[]) {
+    BenchOptions options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--help" || arg == "-h") {
+            print_usage(argv[0]);
+            exit(0);
+        } else if (arg.rfind("--processes=", 0) == 0) {
+            options.processes.clear();
+            for (const std::string& item : split_list(arg.substr(12))) {
+                options.processes.push_back(parse_int(argv[0], "--processes", item, 1, MAX_PROCESSES));
+            }
+        } else if (arg.rfind("--duration=", 0) == 0) {
+            options.duration_ms = parse_int(argv[0], "--duration", arg.substr(11), 10, 60 * 60 * 1000);
+        } else if (arg.rfind("--primitives=", 0) == 0) {
+            options.primitives.clear();
+            for (const std::string& item : split_list(arg.substr(13))) {
+                int found = -1;
+                for (int p = 0; p < PRIMITIVE_COUNT; ++p) {
+                    if (item == PRIMITIVE_NAMES[p]) {
+                        found = p;
+                    }
+                }
+                if (found == -1) {
+                    usage_error(argv[0], "Unknown primitive: " + item);
+                }
+                options.primitives.push_back(static_cast<Primitive>(found));
+            }
+        } else {
+            usage_error(argv[0], "Unknown argument: " + arg);
+        }
+    }
+    if (options.processes.empty() || options.primitives.empty()) {
+        usage_error(argv[0], "Nothing to run");
+    }
+    return options;
+}
+
+std::int64_t monotonic_ns() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<std::int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+BenchArena* create_arena() {
+    void* addr = mmap(nullptr, sizeof(BenchArena), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (addr == MAP_FAILED) {
+        perror("Could not map benchmark arena");
+        exit(1);
+    }
+    auto* arena = static_cast<BenchArena*>(addr);
+    new (&arena->counter) std::atomic<std::int64_t>(0);
+    arena->locked_counter = 0;
+    if (sem_init(&arena->semaphore, 1, 1) == -1) {
+        perror("Could not create semaphore");
+        exit(1);
+    }
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+    if (pthread_mutex_init(&arena->mutex, &attr) != 0) {
+        std::cerr << "Could not create process-shared mutex." << std::endl;
+        exit(1);
+    }
+    pthread_mutexattr_destroy(&attr);
+    new (&arena->ready) std::atomic<int>(0);
+    new (&arena->go) std::atomic<bool>(false);
+    new (&arena->stop) std::atomic<bool>(false);
+    for (int i = 0; i < MAX_PROCESSES; ++i) {
+        new (&arena->shards[i].value) std::atomic<std::int64_t>(0);
+        new (&arena->ops[i].value) std::atomic<std::int64_t>(0);
+        new (&arena->latency[i]) LatencyHistogram();
+    }
+    return arena;
+}
+
+void destroy_arena(BenchArena* arena) {
+    sem_destroy(&arena->semaphore);
+    pthread_mutex_destroy(&arena->mutex);
+    munmap(arena, sizeof(BenchArena));
+}
+
+// One update of the counter with the given primitive.
+inline void update_counter(BenchArena* arena, Primitive primitive, int worker) {
+    switch (primitive) {
+    case PRIMITIVE_SEM:
+        while (sem_wait(&arena->semaphore) == -1) {
+        }
+        arena->locked_counter = arena->locked_counter + 1;
+        sem_post(&arena->semaphore);
+        break;
+    case PRIMITIVE_MUTEX:
+        pthread_mutex_lock(&arena->mutex);
+        arena->locked_counter = arena->locked_counter + 1;
+        pthread_mutex_unlock(&arena->mutex);
+        break;
+    case PRIMITIVE_FETCH_ADD:
+        arena->counter.fetch_add(1, std::memory_order_relaxed);
+        break;
+    case PRIMITIVE_CAS: {
+        std::int64_t value = arena->counter.load(std::memory_order_relaxed);
+        while (!arena->counter.compare_exchange_weak(value, value + 1, std::memory_order_relaxed)) {
+        }
+        break;
+    }
+    case PRIMITIVE_SHARDED:
+        arena->shards[worker].value.fetch_add(1, std::memory_order_relaxed);
+        break;
+    default:
+        break;
+    }
+}
+
+[[noreturn]] void run_worker(BenchArena* arena, Primitive primitive, int worker) {
+    LatencyHistogram& latency = arena->latency[worker];
+    std::int64_t ops = 0;
+
+    arena->ready.fetch_add(1);
+    while (!arena->go.load(std::memory_order_acquire)) {
+        std::this_thread::yield();
+    }
+    while (!arena->stop.load(std::memory_order_relaxed)) {
+        std::int64_t start = monotonic_ns();
+        update_counter(arena, primitive, worker);
+        latency.record(monotonic_ns() - start);
+        ++ops;
+    }
+    arena->ops[worker].value.store(ops);
+    _exit(0);
+}
+
+// Value of the counter as a reader would see it after the run.
+std::int64_t final_counter(const BenchArena* arena, Primitive primitive, int processes) {
+    switch (primitive) {
+    case PRIMITIVE_SEM:
+    case PRIMITIVE_MUTEX:
+        return arena->locked_counter;
+    case PRIMITIVE_SHARDED: {
+        std::int64_t sum = 0;
+        for (int i = 0; i < processes; ++i) {
+            sum += arena->shards[i].value.load();
+        }
+        return sum;
+    }
+    default:
+        return arena->counter.load();
+    }
+}
+
+void run_benchmark(Primitive primitive, int processes, int duration_ms) {
+    BenchArena* arena = create_arena();
+
+    std::vector<pid_t> workers;
+    for (int i = 0; i < processes; ++i) {
+        pid_t pid = fork();
+        if (pid == -1) {
+            perror("fork");
+            // The workers already started wait for `go`; let them run into
+            // `stop` and reap them, so none is left spinning.
+            arena->stop.store(true);
+            arena->go.store(true, std::memory_order_release);
+            for (pid_t worker : workers) {
+                waitpid(worker, nullptr, 0);
+            }
+            destroy_arena(arena);
+            exit(1);
+        }
+        if (pid == 0) {
+            run_worker(arena, primitive, i);
+        }
+        workers.push_back(pid);
+    }
+
+    // Start everybody at once, so the measured window has all processes running.
+    while (arena->ready.load() != processes) {
+        std::this_thread::yield();
+    }
+    std::int64_t start = monotonic_ns();
+    arena->go.store(true, std::memory_order_release);
+    std::this_thread::sleep_for(std::chrono::milliseconds(duration_ms));
+    arena->stop.store(true);
+    for (pid_t pid : workers) {
+        waitpid(pid, nullptr, 0);
+    }
+    double seconds = (monotonic_ns() - start) / 1e9;
+
+    LatencyHistogram total;
+    std::int64_t ops = 0;
+    for (int i = 0; i < processes; ++i) {
+        total.merge(arena->latency[i]);
+        ops += arena->ops[i].value.load();
+    }
+
+    std::int64_t counter = final_counter(arena, primitive, processes);
+    if (counter != ops) {
+        std::cerr << PRIMITIVE_NAMES[primitive] << " with " << processes << " processes lost updates: counter "
+                  << counter << ", updates " << ops << std::endl;
+    }
+
+    std::cout << PRIMITIVE_NAMES[primitive] << ',' << processes << ',' << ops << ',' << seconds << ','
+              << static_cast<std::int64_t>(ops / seconds) << ',' << total.mean() << ','
+              << total.value_at_percentile(50) << ',' << total.value_at_percentile(99) << ','
+              << total.value_at_percentile(99.9) << ',' << total.max() << std::endl;
+
+    destroy_arena(arena);
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    BenchOptions options = parse_options(argc, argv);
+
+    std::cerr << "CPUs online: " << sysconf(_SC_NPROCESSORS_ONLN) << std::endl;
+    std::cout << "primitive,processes,ops,seconds,ops_per_sec,mean_ns,p50_ns,p99_ns,p999_ns,max_ns" << std::endl;
+    for (Primitive primitive : options.primitives) {
+        for (int processes : options.processes) {
+            run_benchmark(primitive, processes, options.duration_ms);
+        }
+    }
+    return 0;
+}
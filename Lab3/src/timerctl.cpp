@@ -0,0 +1,276 @@
+// timerctl - sends commands to the Timer leader over its control socket.
+//
+//     timerctl get | set N | add N | stats | watch
+//     timerctl get NAME | set NAME N | add NAME N | counters
+//     timerctl -          pipelines commands read from stdin, one per line
+//     timerctl top        lists running instances straight from shared memory
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <chrono>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "ControlProtocol.h"
+#include "SharedSegment.h"
+#include "TimestampFormatter.h"
+
+namespace {
+
+void print_usage(const char* program) {
+    std::cerr << "Usage: " << program << " [--socket=PATH] [--persist=PATH] <command>\n"
+              << "Commands:\n"
+              << "  get               print the counter\n"
+              << "  set N             set the counter to N\n"
+              << "  add N             add N to the counter\n"
+              << "  stats             print instance statistics\n"
+              << "  watch             print the counter every time it changes\n"
+              << "  get NAME          print a named counter\n"
+              << "  set NAME N        set a named counter, creating it\n"
+              << "  add NAME N        add N to a named counter, creating it at 0\n"
+              << "  counters          print all named counters\n"
+              << "  -                 send commands from stdin, one per line, without\n"
+              << "                    waiting for each response\n"
+              << "  top [once]        show running instances, read from shared memory\n"
+              << "                    without contacting any instance\n"
+              << "--persist names the segment file of Timers started with --persist (top only)\n"
+              << "Default socket: " << DEFAULT_CONTROL_SOCKET << "\n";
+}
+
+int connect_to(const std::string& path) {
+    struct sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) {
+        std::cerr << "Socket path is too long: " << path << std::endl;
+        return -1;
+    }
+    std::strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd == -1) {
+        perror("socket");
+        return -1;
+    }
+    if (connect(fd, reinterpret_cast<struct sockaddr*>(&address), sizeof(address)) == -1) {
+        std::cerr << "Could not connect to " << path << ": " << std::strerror(errno)
+                  << " (is a Timer leader running?)" << std::endl;
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+bool write_all(int fd, const char* data, std::size_t size) {
+    while (size > 0) {
+        ssize_t written = send(fd, data, size, MSG_NOSIGNAL);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("send");
+            return false;
+        }
+        data += written;
+        size -= static_cast<std::size_t>(written);
+    }
+    return true;
+}
+
+// Copies responses to stdout until the server closes the connection or,
+// when `responses` is not zero, until that many lines were received.
+// Returns false if any response was an error.
+bool print_responses(int fd, std::size_t responses) {
+    bool ok = true;
+    bool line_start = true;
+    std::size_t lines = 0;
+    char buffer[64 * 1024];
+    while (responses == 0 || lines < responses) {
+        ssize_t count = recv(fd, buffer, sizeof(buffer), 0);
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("recv");
+            return false;
+        }
+        if (count == 0) {
+            break;
+        }
+        for (ssize_t i = 0; i < count; ++i) {
+            // Responses start with "ok", "changed" or "err".
+            if (line_start && buffer[i] == 'e') {
+                ok = false;
+            }
+            line_start = buffer[i] == '\n';
+            if (line_start) {
+                ++lines;
+            }
+        }
+        std::cout.write(buffer, count);
+        std::cout.flush();
+    }
+    return ok;
+}
+
+// Sends stdin while a second thread prints the responses, so the server
+// always has the next requests queued and answers them in batches.
+int run_pipelined(int fd) {
+    bool ok = true;
+    std::thread reader([fd, &ok]() { ok = print_responses(fd, 0); });
+
+    std::string line;
+    std::string batch;
+    while (std::getline(std::cin, line)) {
+        if (line.empty()) {
+            continue;
+        }
+        batch += line;
+        batch += '\n';
+        if (batch.size() >= 16 * 1024) {
+            if (!write_all(fd, batch.data(), batch.size())) {
+                break;
+            }
+            batch.clear();
+        }
+    }
+    write_all(fd, batch.data(), batch.size());
+    shutdown(fd, SHUT_WR);
+    reader.join();
+    return ok ? 0 : 1;
+}
+
+std::string format_duration(std::int64_t ns) {
+    std::int64_t seconds = ns / 1000000000;
+    char text[32];
+    if (seconds >= 3600) {
+        snprintf(text, sizeof(text), "%lldh%02lldm", static_cast<long long>(seconds / 3600),
+                 static_cast<long long>(seconds / 60 % 60));
+    } else if (seconds >= 60) {
+        snprintf(text, sizeof(text), "%lldm%02llds", static_cast<long long>(seconds / 60),
+                 static_cast<long long>(seconds % 60));
+    } else {
+        snprintf(text, sizeof(text), "%.1fs", ns / 1e9);
+    }
+    return text;
+}
+
+const char* role_name(std::uint32_t role) {
+    switch (role) {
+    case ROLE_LEADER:
+        return "leader";
+    case ROLE_ADDITIONAL:
+        return "additional";
+    default:
+        return "?";
+    }
+}
+
+// One screen of the top view. Only loads from the read-only mapping.
+std::string render_top(const SharedSegment* segment) {
+    std::int64_t now = TimestampFormatter::now_ns();
+    TimerState state = read_state_snapshot(&segment->state);
+
+    std::ostringstream out;
+    out << "counter " << state.counter << ", leader ";
+    if (state.leader_present) {
+        out << state.leader_pid;
+    } else {
+        out << "none";
+    }
+    out << ", last change " << format_duration(now - state.last_update_ns) << " ago, log dropped "
+        << segment->log_ring.dropped.load(std::memory_order_relaxed) << "\n\n";
+
+    out << std::setw(8) << "PID" << "  " << std::left << std::setw(10) << "ROLE" << std::right
+        << std::setw(10) << "UPTIME" << std::setw(11) << "HEARTBEAT" << std::setw(12) << "OPS"
+        << std::setw(12) << "LOG LINES" << std::setw(10) << "CHILDREN" << "\n";
+    for (const InstanceSlot& slot : segment->registry.slots) {
+        std::uint32_t pid = slot.pid.load(std::memory_order_acquire);
+        if (pid == 0) {
+            continue;
+        }
+        std::int64_t heartbeat_age = now - slot.heartbeat_ns.load(std::memory_order_relaxed);
+        out << std::setw(8) << pid << "  " << std::left << std::setw(10)
+            << role_name(slot.role.load(std::memory_order_relaxed)) << std::right
+            << std::setw(10) << format_duration(now - slot.started_at_ns.load(std::memory_order_relaxed))
+            << std::setw(11) << format_duration(heartbeat_age)
+            << std::setw(12) << slot.ops.load(std::memory_order_relaxed)
+            << std::setw(12) << slot.log_lines.load(std::memory_order_relaxed)
+            << std::setw(10) << slot.children_spawned.load(std::memory_order_relaxed);
+        if (!process_alive(pid)) {
+            out << "  (dead)";
+        } else if (heartbeat_age > 3LL * 1000000000) {
+            out << "  (not responding)";
+        }
+        out << "\n";
+    }
+    return out.str();
+}
+
+int run_top(bool once, const std::string& persist_path) {
+    const SharedSegment* segment = open_shared_segment_readonly(persist_path);
+    if (!segment) {
+        return 1;
+    }
+    while (true) {
+        std::string screen = render_top(segment);
+        if (once) {
+            std::cout << screen;
+            break;
+        }
+        std::cout << "\033[H\033[2J" << screen << std::flush;
+        std::this_thread::sleep_for(std::chrono::seconds(1));
+    }
+    detach_shared_segment(segment);
+    return 0;
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    std::string path = DEFAULT_CONTROL_SOCKET;
+    std::string persist_path;
+    std::string command;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--help" || arg == "-h") {
+            print_usage(argv[0]);
+            return 0;
+        } else if (arg.rfind("--socket=", 0) == 0) {
+            path = arg.substr(9);
+        } else if (arg.rfind("--persist=", 0) == 0) {
+            persist_path = arg.substr(10);
+        } else {
+            command += command.empty() ? arg : " " + arg;
+        }
+    }
+    if (command.empty()) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    if (command == "top" || command == "top once") {
+        return run_top(command == "top once", persist_path);
+    }
+
+    int fd = connect_to(path);
+    if (fd == -1) {
+        return 1;
+    }
+
+    int result;
+    if (command == "-") {
+        result = run_pipelined(fd);
+    } else {
+        std::string request = command + "\n";
+        bool watch = command == "watch";
+        result = write_all(fd, request.data(), request.size()) && print_responses(fd, watch ? 0 : 1) ? 0 : 1;
+    }
+    close(fd);
+    return result;
+}
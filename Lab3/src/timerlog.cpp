@@ -0,0 +1,207 @@
+// timerlog - renders, filters and tails binary Timer logs (Timer --log-format=binary).
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <thread>
+#include <chrono>
+#include <cstring>
+#include <cstdlib>
+#include "BinaryLog.h"
+#include "LogEvents.h"
+#include "LogRing.h"
+#include "TimestampFormatter.h"
+
+namespace {
+
+constexpr std::size_t CHUNK_RECORDS = 1024;
+const auto FOLLOW_POLL = std::chrono::milliseconds(200);
+
+struct ToolOptions {
+    std::string path = "../logs/timer.blog";
+    std::vector<bool> events = std::vector<bool>(EVENT_COUNT, true);
+    bool event_filter = false;
+    std::uint32_t pid = 0;
+    std::uint64_t tail = 0;
+    bool follow = false;
+};
+
+void print_usage(const char* program) {
+    std::cerr << "Usage: " << program << " [options] [log file]\n"
+              << "Options:\n"
+              << "  --event=name[,name...]  show only these events\n"
+              << "  --pid=PID               show only records of this process\n"
+              << "  --tail=N                start from the last N records\n"
+              << "  --follow                keep printing records as they are appended\n"
+              << "  --list-events           print known event names\n";
+}
+
+ToolOptions parse_tool_options(int argc, char* argv[]) {
+    ToolOptions options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--help" || arg == "-h") {
+            print_usage(argv[0]);
+            exit(0);
+        } else if (arg == "--list-events") {
+            for (std::uint16_t event = 0; event < EVENT_COUNT; ++event) {
+                std::cout << log_event_name(event) << "\n";
+            }
+            exit(0);
+        } else if (arg.rfind("--event=", 0) == 0) {
+            if (!options.event_filter) {
+                options.events.assign(EVENT_COUNT, false);
+                options.event_filter = true;
+            }
+            std::string names = arg.substr(8);
+            std::size_t start = 0;
+            while (start <= names.size()) {
+                std::size_t end = names.find(',', start);
+                std::string name = names.substr(start, end == std::string::npos ? std::string::npos : end - start);
+                std::uint16_t event = log_event_by_name(name.c_str());
+                if (event == EVENT_COUNT) {
+                    std::cerr << "Unknown event: " << name << std::endl;
+                    exit(1);
+                }
+                options.events[event] = true;
+                if (end == std::string::npos) {
+                    break;
+                }
+                start = end + 1;
+            }
+        } else if (arg.rfind("--pid=", 0) == 0) {
+            options.pid = static_cast<std::uint32_t>(std::strtoul(arg.c_str() + 6, nullptr, 10));
+        } else if (arg.rfind("--tail=", 0) == 0) {
+            options.tail = std::strtoull(arg.c_str() + 7, nullptr, 10);
+        } else if (arg == "--follow" || arg == "-f") {
+            options.follow = true;
+        } else if (!arg.empty() && arg[0] != '-') {
+            options.path = arg;
+        } else {
+            std::cerr << "Unknown argument: " << arg << std::endl;
+            print_usage(argv[0]);
+            exit(1);
+        }
+    }
+    if (!options.event_filter) {
+        options.events[EVENT_CLOCK_ANCHOR] = false;
+    }
+    return options;
+}
+
+std::uint64_t record_count(std::ifstream& log) {
+    log.clear();
+    log.seekg(0, std::ios::end);
+    auto size = static_cast<std::uint64_t>(log.tellg());
+    return size < sizeof(BinaryLogHeader) ? 0 : (size - sizeof(BinaryLogHeader)) / sizeof(BinaryLogRecord);
+}
+
+void seek_record(std::ifstream& log, std::uint64_t index) {
+    log.clear();
+    log.seekg(static_cast<std::streamoff>(sizeof(BinaryLogHeader) + index * sizeof(BinaryLogRecord)));
+}
+
+// Finds the clock anchor in effect at record `index` by scanning backwards.
+// Falls back to the current offset, which is right for logs written since the last boot.
+std::int64_t find_clock_offset(std::ifstream& log, std::uint64_t index) {
+    std::vector<BinaryLogRecord> chunk(CHUNK_RECORDS);
+    while (index > 0) {
+        std::uint64_t start = index > CHUNK_RECORDS ? index - CHUNK_RECORDS : 0;
+        std::uint64_t count = index - start;
+        seek_record(log, start);
+        log.read(reinterpret_cast<char*>(chunk.data()), static_cast<std::streamsize>(count * sizeof(BinaryLogRecord)));
+        for (std::uint64_t i = count; i-- > 0;) {
+            if (chunk[i].event == EVENT_CLOCK_ANCHOR) {
+                return chunk[i].payload;
+            }
+        }
+        index = start;
+    }
+    return TimestampFormatter::now_ns() - monotonic_ns();
+}
+
+std::string read_text(std::ifstream& arena, const BinaryLogRecord& record) {
+    std::string text(record.text_length, '\0');
+    if (record.text_length == 0 || !arena.is_open()) {
+        return text;
+    }
+    arena.clear();
+    arena.seekg(static_cast<std::streamoff>(record.text_offset));
+    arena.read(&text[0], record.text_length);
+    text.resize(static_cast<std::size_t>(arena.gcount()));
+    return text;
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    ToolOptions options = parse_tool_options(argc, argv);
+
+    std::ifstream log(options.path, std::ios::binary);
+    if (!log.is_open()) {
+        std::cerr << "Failed to open " << options.path << std::endl;
+        return 1;
+    }
+    BinaryLogHeader header = {};
+    log.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!log || std::memcmp(header.magic, BINARY_LOG_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != BINARY_LOG_VERSION || header.record_size != sizeof(BinaryLogRecord)) {
+        std::cerr << options.path << " is not a binary Timer log." << std::endl;
+        return 1;
+    }
+    std::ifstream arena(binary_log_arena_path(options.path), std::ios::binary);
+
+    std::uint64_t next = 0;
+    std::uint64_t count = record_count(log);
+    if (options.tail > 0 && options.tail < count) {
+        next = count - options.tail;
+    }
+    std::int64_t clock_offset = find_clock_offset(log, next);
+
+    TimestampFormatter formatter;
+    std::vector<BinaryLogRecord> chunk(CHUNK_RECORDS);
+    char line[TimestampFormatter::LENGTH + 3 + 1024];
+
+    while (true) {
+        count = record_count(log);
+        if (next >= count) {
+            if (!options.follow) {
+                break;
+            }
+            std::cout.flush();
+            std::this_thread::sleep_for(FOLLOW_POLL);
+            continue;
+        }
+
+        std::uint64_t read_count = std::min<std::uint64_t>(count - next, CHUNK_RECORDS);
+        seek_record(log, next);
+        log.read(reinterpret_cast<char*>(chunk.data()), static_cast<std::streamsize>(read_count * sizeof(BinaryLogRecord)));
+        next += read_count;
+
+        for (std::uint64_t i = 0; i < read_count; ++i) {
+            const BinaryLogRecord& record = chunk[i];
+            if (record.event == EVENT_CLOCK_ANCHOR) {
+                clock_offset = record.payload;
+            }
+            if (record.event < EVENT_COUNT && !options.events[record.event]) {
+                continue;
+            }
+            if (options.pid != 0 && record.pid != options.pid) {
+                continue;
+            }
+
+            std::string text = read_text(arena, record);
+            std::size_t n = formatter.format(record.monotonic_ns + clock_offset, line);
+            std::memcpy(line + n, " - ", 3);
+            n += 3;
+            n += render_log_event(record.event, record.payload, record.pid, text.data(), text.size(),
+                                  line + n, sizeof(line) - n - 1);
+            line[n++] = '\n';
+            std::cout.write(line, static_cast<std::streamsize>(n));
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,200 @@
+#include "BufferedLogWriter.h"
+#include <algorithm>
+#include <charconv>
+#include <iterator>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#else
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+#ifdef _WIN32
+int openForAppend(const std::string& path) {
+    return _open(path.c_str(), _O_RDWR | _O_CREAT | _O_APPEND | _O_BINARY, _S_IREAD | _S_IWRITE);
+}
+
+long long fileSize(int fd) {
+    return _lseeki64(fd, 0, SEEK_END);
+}
+
+bool readAt(int fd, char* data, std::size_t size, long long offset) {
+    return _lseeki64(fd, offset, SEEK_SET) == offset &&
+           _read(fd, data, static_cast<unsigned int>(size)) == static_cast<int>(size);
+}
+
+bool truncateFile(int fd, long long size) {
+    return _chsize_s(fd, size) == 0;
+}
+
+bool writeAll(int fd, const char* data, std::size_t size) {
+    return _write(fd, data, static_cast<unsigned int>(size)) == static_cast<int>(size);
+}
+
+void syncFile(int fd) {
+    _commit(fd);
+}
+
+void closeFile(int fd) {
+    _close(fd);
+}
+#else
+int openForAppend(const std::string& path) {
+    return ::open(path.c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+}
+
+long long fileSize(int fd) {
+    struct stat st;
+    return fstat(fd, &st) == 0 ? static_cast<long long>(st.st_size) : -1;
+}
+
+bool readAt(int fd, char* data, std::size_t size, long long offset) {
+    return pread(fd, data, size, static_cast<off_t>(offset)) == static_cast<ssize_t>(size);
+}
+
+bool truncateFile(int fd, long long size) {
+    return ftruncate(fd, static_cast<off_t>(size)) == 0;
+}
+
+bool writeAll(int fd, const char* data, std::size_t size) {
+    while (size > 0) {
+        ssize_t written = write(fd, data, size);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += written;
+        size -= static_cast<std::size_t>(written);
+    }
+    return true;
+}
+
+void syncFile(int fd) {
+    if (fdatasync(fd) == -1) {
+        perror("Failed to sync log file");
+    }
+}
+
+void closeFile(int fd) {
+    ::close(fd);
+}
+#endif
+
+// Cuts a last line left without its newline by a crash, so the next sample
+// starts a line of its own instead of being glued onto the torn one.
+void dropTornTail(int fd, const std::string& path) {
+    long long size = fileSize(fd);
+    char last;
+    if (size <= 0 || !readAt(fd, &last, 1, size - 1) || last == '\n') {
+        return;
+    }
+    // Keeps everything up to and including the last newline.
+    char chunk[4096];
+    long long keep = 0;
+    for (long long end = size; end > 0;) {
+        long long begin = std::max(0LL, end - static_cast<long long>(sizeof(chunk)));
+        std::size_t length = static_cast<std::size_t>(end - begin);
+        if (!readAt(fd, chunk, length, begin)) {
+            return;
+        }
+        auto newline = std::find(std::make_reverse_iterator(chunk + length), std::make_reverse_iterator(chunk), '\n');
+        if (newline.base() != chunk) {
+            keep = begin + (newline.base() - chunk);
+            break;
+        }
+        end = begin;
+    }
+    if (!truncateFile(fd, keep)) {
+        std::cerr << "Failed to drop the torn last line of " << path << std::endl;
+    }
+}
+
+}
+
+BufferedLogWriter::BufferedLogWriter(FlushPolicy policy) : policy_(policy) {
+    policy_.batchBytes = std::min(policy_.batchBytes, BUFFER_SIZE - MAX_LINE);
+}
+
+BufferedLogWriter::~BufferedLogWriter() {
+    close();
+}
+
+bool BufferedLogWriter::open(const std::string& path) {
+    close();
+    fd_ = openForAppend(path);
+    if (fd_ == -1) {
+        std::cerr << "Failed to open " << path << std::endl;
+        return false;
+    }
+    dropTornTail(fd_, path);
+    return true;
+}
+
+void BufferedLogWriter::close() {
+    if (fd_ != -1) {
+        flush();
+        closeFile(fd_);
+        fd_ = -1;
+    }
+}
+
+void BufferedLogWriter::appendSample(std::time_t timestamp, float value) {
+    // "nan" or "inf" would make the line unreadable for the log readers.
+    if (!std::isfinite(value)) {
+        std::cerr << "Dropping a non-finite sample" << std::endl;
+        return;
+    }
+    char* out = buffer_ + used_;
+    char* end = out + MAX_LINE - 1; // the newline
+    auto written = std::to_chars(out, end, static_cast<long long>(timestamp));
+    if (written.ec == std::errc()) {
+        *written.ptr++ = ' ';
+        written = std::to_chars(written.ptr, end, value, std::chars_format::fixed, 2);
+    }
+    if (written.ec != std::errc()) {
+        std::cerr << "Dropping a sample that does not fit in a log line" << std::endl;
+        return;
+    }
+    *written.ptr++ = '\n';
+    if (used_ == 0) {
+        oldest_ = std::chrono::steady_clock::now();
+    }
+    used_ = static_cast<std::size_t>(written.ptr - buffer_);
+
+    if (policy_.durability == LogDurability::EverySample || used_ >= policy_.batchBytes) {
+        flush();
+    }
+}
+
+void BufferedLogWriter::flushIfDue() {
+    if (used_ > 0 && std::chrono::steady_clock::now() - oldest_ >= policy_.maxDelay) {
+        flush();
+    }
+}
+
+void BufferedLogWriter::flush() {
+    if (used_ == 0) {
+        return;
+    }
+    // Without an open file (it failed to open) the samples are dropped.
+    if (fd_ != -1) {
+        if (!writeAll(fd_, buffer_, used_)) {
+            perror("Failed to write log file");
+        } else if (policy_.durability == LogDurability::Synced) {
+            syncFile(fd_);
+        }
+    }
+    used_ = 0;
+}
@@ -0,0 +1,61 @@
+#ifndef BUFFERED_LOG_WRITER_H
+#define BUFFERED_LOG_WRITER_H
+
+#include <chrono>
+#include <cstddef>
+#include <ctime>
+#include <limits>
+#include <string>
+
+enum class LogDurability {
+    Buffered,    // written when the batch is full or old enough
+    EverySample, // written right after every sample
+    Synced       // like Buffered, and every write is followed by fdatasync
+};
+
+struct FlushPolicy {
+    LogDurability durability = LogDurability::Buffered;
+    std::size_t batchBytes = 4096;            // write once this much is buffered
+    std::chrono::milliseconds maxDelay{1000}; // or once the oldest buffered sample is this old
+};
+
+// Long-lived writer for "<unix time> <value>" lines. Owns the file
+// descriptor and formats samples straight into its buffer with to_chars, so
+// a sample costs no allocation and, between writes, no syscall. A crash
+// loses at most what is buffered; only Synced also survives power loss.
+class BufferedLogWriter {
+public:
+    explicit BufferedLogWriter(FlushPolicy policy = FlushPolicy());
+    ~BufferedLogWriter();
+
+    BufferedLogWriter(const BufferedLogWriter&) = delete;
+    BufferedLogWriter& operator=(const BufferedLogWriter&) = delete;
+
+    // Flushes and closes the current file, then opens `path` for appending.
+    // A last line torn by a crash (no newline) is cut off first.
+    bool open(const std::string& path);
+    void close();
+
+    void appendSample(std::time_t timestamp, float value);
+
+    // Writes the buffer if the oldest sample in it is older than maxDelay.
+    // Call it periodically, samples may stop arriving.
+    void flushIfDue();
+
+    void flush();
+
+private:
+    static constexpr std::size_t BUFFER_SIZE = 64 * 1024;
+    // Longest line: a negative 64-bit time, a space, -FLT_MAX with two
+    // decimals (39 integer digits) and the newline.
+    static constexpr std::size_t MAX_LINE = (std::numeric_limits<long long>::digits10 + 2) + 1 +
+                                            (std::numeric_limits<float>::max_exponent10 + 1 + 4) + 1;
+
+    FlushPolicy policy_;
+    int fd_ = -1;
+    char buffer_[BUFFER_SIZE];
+    std::size_t used_ = 0;
+    std::chrono::steady_clock::time_point oldest_;
+};
+
+#endif
@@ -3,7 +3,7 @@
 #include <cstdlib>
 #include <ctime>
 #include <thread>
-#include <iomanip>
+#include "TimestampFormatter.h"
 
 #ifdef _WIN32
 #include <windows.h>
@@ -137,6 +137,7 @@ int main() {
     float temperature = 20.0; 
     const float minDelta = -0.5; 
     const float maxDelta = 0.5;  
+    TimestampFormatter timestampFormatter;
 
     while (true) {
         float delta = minDelta + static_cast<float>(std::rand()) / RAND_MAX * (maxDelta - minDelta);
@@ -148,9 +149,9 @@ int main() {
         std::string data = std::to_string(temperature) + "\n";
         writeToSerial(serialPort, data);
 
-        std::time_t now = std::time(nullptr);
-        std::cout << std::put_time(std::localtime(&now), "%Y-%m-%d %H:%M:%S")
-                  << " " << temperature << std::endl;
+        char timestamp[TimestampFormatter::LENGTH];
+        timestampFormatter.format_now(timestamp);
+        std::cout.write(timestamp, sizeof(timestamp)) << " " << temperature << std::endl;
 
         std::this_thread::sleep_for(std::chrono::seconds(5));
     }
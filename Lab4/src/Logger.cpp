@@ -1,14 +1,7 @@
 #include <iostream>
-#include <fstream>
-#include <vector>
 #include <string>
-#include <sstream>
 #include <chrono>
-#include <thread>
 #include <ctime>
-#include <algorithm>
-#include <numeric>
-#include <iomanip>
 
 #ifdef _WIN32
 #include <windows.h>
@@ -18,6 +11,10 @@
 #include <termios.h>
 #endif
 #include <filesystem>
+#include "LogRotator.h"
+#include "Rollup.h"
+#include "SegmentedLog.h"
+#include "SerialLineReader.h"
 
 #ifdef _WIN32
 HANDLE initializeSerialPort(const std::string& port) {
@@ -103,84 +100,6 @@ int initializeSerialPort(const std::string& port) {
 }
 #endif
 
-#ifdef _WIN32
-std::string readFromSerial(HANDLE hSerial) {
-    char buffer[64] = {0};
-    DWORD bytesRead = 0;
-    if (ReadFile(hSerial, buffer, sizeof(buffer) - 1, &bytesRead, nullptr)) {
-        buffer[bytesRead] = '\0';
-        return std::string(buffer);
-    } else {
-        std::cerr << "Error reading from serial port" << std::endl;
-        return "";
-    }
-}
-#else
-std::string readFromSerial(int fd) {
-    char buffer[64] = {0};
-    int bytesRead = read(fd, buffer, sizeof(buffer) - 1);
-    if (bytesRead > 0) {
-        buffer[bytesRead] = '\0';
-        return std::string(buffer);
-    } else {
-        perror("Error reading from serial port");
-        return "";
-    }
-}
-#endif
-
-void logTemperature(const std::string& logFile, float temperature) {
-    std::ofstream log(logFile, std::ios::app);
-    std::time_t now = std::time(nullptr);
-    log << now << " "  << std::fixed << std::setprecision(2) << temperature << std::endl;
-}
-
-std::vector<std::pair<std::time_t, float>> filterLogData(const std::string& logFile, int maxAgeInSeconds) {
-    std::ifstream inFile(logFile);
-    std::vector<std::pair<std::time_t, float>> filteredData;
-    std::string line;
-    std::time_t now = std::time(nullptr);
-
-    while (std::getline(inFile, line)) {
-        std::istringstream iss(line);
-        std::time_t timestamp;
-        float value;
-        if (iss >> timestamp >> value) {
-            if (now - timestamp <= maxAgeInSeconds) {
-                filteredData.emplace_back(timestamp, value);
-            }
-        }
-    }
-    return filteredData;
-}
-
-void calculateAndLogAverage(const std::string& inputLog, const std::string& outputLog, int intervalInSeconds) {
-    auto filteredData = filterLogData(inputLog, intervalInSeconds);
-    std::vector<float> temperatures;
-
-    for (const auto& entry : filteredData) {
-        temperatures.push_back(entry.second);
-    }
-
-    if (!temperatures.empty()) {
-        float avg = std::accumulate(temperatures.begin(), temperatures.end(), 0.0) / temperatures.size();
-        std::time_t now = std::time(nullptr);
-        std::ofstream outLog(outputLog, std::ios::app);
-        outLog << now << " " << avg << std::endl;
-    }
-}
-
-
-void cleanOldData(const std::string& logFile, int maxAgeInSeconds) {
-    auto filteredData = filterLogData(logFile, maxAgeInSeconds);
-    std::ofstream outFile(logFile, std::ios::trunc);
-
-    for (const auto& entry : filteredData) {
-        outFile << entry.first << " " << entry.second << std::endl;
-    }
-}
-
-
 int main() {
     const std::string port = 
     #ifdef _WIN32
@@ -190,10 +109,44 @@ int main() {
     #endif
     const std::string logDir = "../logs";
     std::filesystem::create_directories(logDir);
-    const std::string logFile = logDir + "/temperature.log";
+    const std::string legacyLogFile = logDir + "/temperature.log";
     const std::string hourlyLogFile = logDir + "/hourly_average.log";
     const std::string dailyLogFile = logDir + "/daily_average.log";
 
+
+    // Measurements of the last 24 hours, one file per hour in ../logs/temperature.
+    // Samples are written out in batches, at most a second after they arrive.
+    FlushPolicy flushPolicy;
+    flushPolicy.durability = LogDurability::Buffered;
+    flushPolicy.maxDelay = std::chrono::milliseconds(1000);
+    SegmentedLog temperatureLog(logDir + "/temperature", 3600, 24 * 3600, flushPolicy);
+    temperatureLog.importLegacyLog(legacyLogFile);
+
+    // Rollup levels, finest first: resolution, log and retention. Each level
+    // is computed from the one below; the logs are rotated and dropped as
+    // whole files instead of being rewritten to remove old lines.
+    auto retention = [](RotationInterval interval, int days) {
+        RotationPolicy policy;
+        policy.interval = interval;
+        policy.max_age_days = days;
+        return policy;
+    };
+    RollupEngine rollups({
+        { "10s", Resolution::fixed(10), logDir + "/rollup_10s.log", retention(RotationInterval::Hourly, 1) },
+        { "1m", Resolution::fixed(60), logDir + "/rollup_1m.log", retention(RotationInterval::Daily, 7) },
+        { "1h", Resolution::fixed(3600), hourlyLogFile, retention(RotationInterval::Daily, 31) },
+        { "1d", Resolution::day(), dailyLogFile, retention(RotationInterval::Monthly, 365) },
+    });
+    // After a restart the open windows are rebuilt from the stored samples.
+    rollups.restore(temperatureLog.readSince(rollups.restoreFrom(std::time(nullptr))));
+
+    std::time_t started = std::time(nullptr);
+    WindowStats lastDay = readRollup(hourlyLogFile, started - 24 * 3600, started);
+    if (lastDay.count > 0) {
+        std::cout << "Last 24 hours: p50 " << lastDay.quantile(0.5) << ", p95 " << lastDay.quantile(0.95)
+                  << ", p99 " << lastDay.quantile(0.99) << std::endl;
+    }
+
     auto serialPort = initializeSerialPort(port);
     if (
         #ifdef _WIN32
@@ -205,35 +158,26 @@ int main() {
         return 1;
     }
 
-    while (true) {
-        auto data = readFromSerial(serialPort);
-        if (!data.empty()) {
-            try {
-                float temperature = std::stof(data);
-                logTemperature(logFile, temperature);
-
-                cleanOldData(logFile, 24 * 3600);
-
-                static auto lastHourlyCheck = std::chrono::system_clock::now();
-                if (std::chrono::system_clock::now() - lastHourlyCheck >= std::chrono::hours(1)) {
-                    calculateAndLogAverage(logFile, hourlyLogFile, 3600);
-                    cleanOldData(hourlyLogFile, 30 * 24 * 3600); 
-                    lastHourlyCheck = std::chrono::system_clock::now();
-                }
-
-                static auto lastDailyCheck = std::chrono::system_clock::now();
-                if (std::chrono::system_clock::now() - lastDailyCheck >= std::chrono::hours(24)) {
-                    calculateAndLogAverage(hourlyLogFile, dailyLogFile, 24 * 3600);
-                    cleanOldData(dailyLogFile, 365 * 24 * 3600);
-                    lastDailyCheck = std::chrono::system_clock::now();
-                }
-
-                std::cout << "Logged: " << temperature << std::endl;
-            } catch (...) {
-                std::cerr << "Failed to parse temperature." << std::endl;
+    // Every reading is logged as soon as its line arrives. The wait is cut
+    // short so that windows are closed and the log is flushed on time even
+    // when nothing comes in.
+    SerialLineReader serialReader(serialPort);
+    bool portOpen = true;
+    while (portOpen) {
+        portOpen = serialReader.poll(std::chrono::milliseconds(200), [&](std::string_view frame) {
+            float temperature;
+            if (!parseReading(frame, temperature)) {
+                std::cerr << "Failed to parse temperature: " << frame << std::endl;
+                return;
             }
-        }
-        std::this_thread::sleep_for(std::chrono::seconds(1));
+            std::time_t now = std::time(nullptr);
+            temperatureLog.append(now, temperature);
+            rollups.addSample(now, temperature);
+
+            std::cout << "Logged: " << temperature << std::endl;
+        });
+        rollups.tick(std::time(nullptr));
+        temperatureLog.flushIfDue();
     }
 
 #ifdef _WIN32
@@ -241,5 +185,5 @@ int main() {
 #else
     close(serialPort);
 #endif
-    return 0;
+    return 1;
 }
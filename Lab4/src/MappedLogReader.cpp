@@ -0,0 +1,167 @@
+#include "MappedLogReader.h"
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+MappedFile::MappedFile(const std::string& path) {
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                              nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return;
+    }
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+        CloseHandle(file);
+        return;
+    }
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping) {
+        CloseHandle(file);
+        return;
+    }
+    data_ = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    if (!data_) {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return;
+    }
+    size_ = static_cast<std::size_t>(size.QuadPart);
+    file_ = file;
+    mapping_ = mapping;
+}
+
+MappedFile::~MappedFile() {
+    if (data_) {
+        UnmapViewOfFile(data_);
+        CloseHandle(mapping_);
+        CloseHandle(file_);
+    }
+}
+#else
+MappedFile::MappedFile(const std::string& path) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        return;
+    }
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        void* addr = mmap(nullptr, static_cast<std::size_t>(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+        if (addr != MAP_FAILED) {
+            data_ = static_cast<const char*>(addr);
+            size_ = static_cast<std::size_t>(st.st_size);
+        }
+    }
+    // The mapping stays valid without the descriptor.
+    close(fd);
+}
+
+MappedFile::~MappedFile() {
+    if (data_) {
+        munmap(const_cast<char*>(data_), size_);
+    }
+}
+#endif
+
+namespace {
+
+// Parses "<time> <value>" from [line, end). False for a malformed line.
+bool parseSample(const char* line, const char* end, std::time_t& timestamp, float& value) {
+    std::int64_t time = 0;
+    auto parsed = std::from_chars(line, end, time);
+    if (parsed.ec != std::errc() || parsed.ptr == end || *parsed.ptr != ' ') {
+        return false;
+    }
+    const char* next = parsed.ptr;
+    while (next != end && *next == ' ') {
+        ++next;
+    }
+    parsed = std::from_chars(next, end, value);
+    if (parsed.ec != std::errc()) {
+        return false;
+    }
+    timestamp = static_cast<std::time_t>(time);
+    return true;
+}
+
+// End of the line starting at `line`: its newline, or nullptr when the line
+// is not terminated.
+const char* lineEnd(const char* line, const char* end) {
+    return static_cast<const char*>(std::memchr(line, '\n', static_cast<std::size_t>(end - line)));
+}
+
+// First line start at or after `position`.
+std::size_t nextLineStart(const char* data, std::size_t size, std::size_t position) {
+    if (position == 0) {
+        return 0;
+    }
+    const char* newline = lineEnd(data + position - 1, data + size);
+    return newline ? static_cast<std::size_t>(newline - data) + 1 : size;
+}
+
+// Offset of a line start such that every complete line before it is older
+// than `from`. Unparsable lines count as older.
+std::size_t findFirstInRange(const char* data, std::size_t size, std::time_t from) {
+    std::size_t low = 0;
+    std::size_t high = size;
+    while (low < high) {
+        std::size_t middle = low + (high - low) / 2;
+        std::size_t line = nextLineStart(data, size, middle);
+        if (line >= high) {
+            // No line starts in [middle, high).
+            high = middle;
+            continue;
+        }
+        const char* newline = lineEnd(data + line, data + size);
+        if (!newline) {
+            high = line;
+            continue;
+        }
+        std::time_t timestamp;
+        float value;
+        if (!parseSample(data + line, newline, timestamp, value) || timestamp < from) {
+            low = static_cast<std::size_t>(newline - data) + 1;
+        } else {
+            high = line;
+        }
+    }
+    return low;
+}
+
+}
+
+std::vector<std::pair<std::time_t, float>> readLogSince(const std::string& path, std::time_t from) {
+    std::vector<std::pair<std::time_t, float>> samples;
+    MappedFile file(path);
+    if (!file.data()) {
+        return samples;
+    }
+    const char* data = file.data();
+    const char* end = data + file.size();
+
+    const char* line = data + findFirstInRange(data, file.size(), from);
+    // Sample lines are about 17 bytes, this avoids most reallocations.
+    samples.reserve(static_cast<std::size_t>(end - line) / 16);
+    while (line < end) {
+        const char* newline = lineEnd(line, end);
+        if (!newline) {
+            break;
+        }
+        std::time_t timestamp;
+        float value;
+        if (parseSample(line, newline, timestamp, value) && timestamp >= from) {
+            samples.emplace_back(timestamp, value);
+        }
+        line = newline + 1;
+    }
+    return samples;
+}
@@ -0,0 +1,39 @@
+#ifndef MAPPED_LOG_READER_H
+#define MAPPED_LOG_READER_H
+
+#include <cstddef>
+#include <ctime>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Read-only memory mapping of a whole file. An empty or missing file maps
+// to no data.
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const char* data() const { return data_; }
+    std::size_t size() const { return size_; }
+
+private:
+    const char* data_ = nullptr;
+    std::size_t size_ = 0;
+#ifdef _WIN32
+    void* file_ = nullptr;
+    void* mapping_ = nullptr;
+#endif
+};
+
+// Samples of a "<unix time> <value>" log with timestamp >= from, oldest
+// first. The log is appended in time order, so the first line in range is
+// found by binary search over line starts and only the pages from there to
+// the end are touched; numbers are parsed with from_chars. A last line
+// without its newline (torn by a crash or still being written) is skipped.
+std::vector<std::pair<std::time_t, float>> readLogSince(const std::string& path, std::time_t from);
+
+#endif
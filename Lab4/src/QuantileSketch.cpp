@@ -0,0 +1,151 @@
+#include "QuantileSketch.h"
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <iterator>
+#include <utility>
+
+namespace {
+
+const double GAMMA = (1 + QuantileSketch::RELATIVE_ACCURACY) / (1 - QuantileSketch::RELATIVE_ACCURACY);
+const double LOG_GAMMA = std::log(GAMMA);
+
+void appendBuckets(std::string& out, const std::map<int, std::uint64_t>& buckets) {
+    char number[24];
+    bool first = true;
+    for (const auto& bucket : buckets) {
+        if (!first) {
+            out += ',';
+        }
+        first = false;
+        out.append(number, std::to_chars(number, number + sizeof(number), bucket.first).ptr);
+        out += ':';
+        out.append(number, std::to_chars(number, number + sizeof(number), bucket.second).ptr);
+    }
+}
+
+// Parses "<key>:<count>,..." up to `end`, adding to `buckets` and `count`.
+bool parseBuckets(const char* begin, const char* end, std::map<int, std::uint64_t>& buckets, std::uint64_t& count) {
+    while (begin != end) {
+        int key = 0;
+        std::uint64_t n = 0;
+        auto parsed = std::from_chars(begin, end, key);
+        if (parsed.ec != std::errc() || parsed.ptr == end || *parsed.ptr != ':') {
+            return false;
+        }
+        parsed = std::from_chars(parsed.ptr + 1, end, n);
+        if (parsed.ec != std::errc() || (parsed.ptr != end && *parsed.ptr != ',')) {
+            return false;
+        }
+        buckets[key] += n;
+        count += n;
+        begin = parsed.ptr == end ? end : parsed.ptr + 1;
+    }
+    return true;
+}
+
+}
+
+int QuantileSketch::keyOf(double magnitude) {
+    return static_cast<int>(std::ceil(std::log(magnitude) / LOG_GAMMA));
+}
+
+double QuantileSketch::valueOf(int key) {
+    // Bucket `key` holds (GAMMA^(key-1), GAMMA^key]; this point is within
+    // RELATIVE_ACCURACY of both ends.
+    return 2 * std::exp(key * LOG_GAMMA) / (GAMMA + 1);
+}
+
+void QuantileSketch::collapse(std::map<int, std::uint64_t>& buckets) {
+    while (buckets.size() > MAX_BUCKETS) {
+        auto lowest = buckets.begin();
+        std::next(lowest)->second += lowest->second;
+        buckets.erase(lowest);
+    }
+}
+
+void QuantileSketch::add(float value) {
+    if (!std::isfinite(value)) {
+        return;
+    }
+    double magnitude = std::fabs(static_cast<double>(value));
+    if (magnitude < MIN_VALUE) {
+        ++zero_;
+    } else if (value > 0) {
+        ++positive_[keyOf(magnitude)];
+        collapse(positive_);
+    } else {
+        ++negative_[keyOf(magnitude)];
+        collapse(negative_);
+    }
+    ++count_;
+}
+
+void QuantileSketch::merge(const QuantileSketch& other) {
+    for (const auto& bucket : other.positive_) {
+        positive_[bucket.first] += bucket.second;
+    }
+    for (const auto& bucket : other.negative_) {
+        negative_[bucket.first] += bucket.second;
+    }
+    collapse(positive_);
+    collapse(negative_);
+    zero_ += other.zero_;
+    count_ += other.count_;
+}
+
+double QuantileSketch::quantile(double q) const {
+    if (count_ == 0) {
+        return 0;
+    }
+    q = std::min(1.0, std::max(0.0, q));
+    auto rank = static_cast<std::uint64_t>(q * static_cast<double>(count_ - 1));
+    std::uint64_t seen = 0;
+    // Ascending value order: largest negative magnitudes first.
+    for (auto bucket = negative_.rbegin(); bucket != negative_.rend(); ++bucket) {
+        seen += bucket->second;
+        if (seen > rank) {
+            return -valueOf(bucket->first);
+        }
+    }
+    seen += zero_;
+    if (seen > rank) {
+        return 0;
+    }
+    for (const auto& bucket : positive_) {
+        seen += bucket.second;
+        if (seen > rank) {
+            return valueOf(bucket.first);
+        }
+    }
+    return positive_.empty() ? 0 : valueOf(positive_.rbegin()->first);
+}
+
+void QuantileSketch::appendTo(std::string& out) const {
+    char number[24];
+    out.append(number, std::to_chars(number, number + sizeof(number), zero_).ptr);
+    out += ';';
+    appendBuckets(out, positive_);
+    out += ';';
+    appendBuckets(out, negative_);
+}
+
+bool QuantileSketch::parse(const char* begin, const char* end) {
+    QuantileSketch sketch;
+    auto parsed = std::from_chars(begin, end, sketch.zero_);
+    if (parsed.ec != std::errc() || parsed.ptr == end || *parsed.ptr != ';') {
+        return false;
+    }
+    const char* positive = parsed.ptr + 1;
+    const char* separator = std::find(positive, end, ';');
+    if (separator == end) {
+        return false;
+    }
+    sketch.count_ = sketch.zero_;
+    if (!parseBuckets(positive, separator, sketch.positive_, sketch.count_) ||
+        !parseBuckets(separator + 1, end, sketch.negative_, sketch.count_)) {
+        return false;
+    }
+    *this = std::move(sketch);
+    return true;
+}
@@ -0,0 +1,46 @@
+#ifndef QUANTILE_SKETCH_H
+#define QUANTILE_SKETCH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+
+// DDSketch: a histogram with logarithmically sized buckets, so any quantile
+// is returned with at most RELATIVE_ACCURACY relative error. Two sketches
+// merge by adding bucket counts, which gives exactly the sketch of all their
+// samples; that is what lets rollup levels combine them. Values closer to
+// zero than MIN_VALUE (below the 0.01 resolution of the logs) are counted as
+// zero, which bounds the number of buckets for any realistic range; beyond
+// MAX_BUCKETS per sign the buckets nearest zero are folded together.
+class QuantileSketch {
+public:
+    static constexpr double RELATIVE_ACCURACY = 0.01;
+    static constexpr double MIN_VALUE = 0.01;
+    static constexpr std::size_t MAX_BUCKETS = 1024;
+
+    void add(float value);
+    void merge(const QuantileSketch& other);
+
+    std::uint64_t count() const { return count_; }
+
+    // Value at rank q * (count - 1), q in [0, 1]. 0 for an empty sketch.
+    double quantile(double q) const;
+
+    // One token without spaces: "<zero count>;<key>:<count>,...;<key>:<count>,..."
+    // with the positive buckets first and then the negative ones.
+    void appendTo(std::string& out) const;
+    bool parse(const char* begin, const char* end);
+
+private:
+    static int keyOf(double magnitude);
+    static double valueOf(int key);
+    static void collapse(std::map<int, std::uint64_t>& buckets);
+
+    std::map<int, std::uint64_t> positive_;
+    std::map<int, std::uint64_t> negative_; // keyed by magnitude
+    std::uint64_t zero_ = 0;
+    std::uint64_t count_ = 0;
+};
+
+#endif
@@ -0,0 +1,133 @@
+#include "Rollup.h"
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+
+#ifdef LOG_ROTATION_GZIP
+#include <zlib.h>
+#endif
+
+RollupEngine::RollupEngine(const std::vector<RollupLevelConfig>& levels) {
+    if (levels.empty()) {
+        throw std::invalid_argument("at least one rollup level is needed");
+    }
+    for (std::size_t i = 0; i < levels.size(); ++i) {
+        const Resolution& resolution = levels[i].resolution;
+        if (resolution.seconds <= 0 || (i > 0 && resolution.seconds % levels[i - 1].resolution.seconds != 0) ||
+            (i > 0 && levels[i - 1].resolution.localDay)) {
+            throw std::invalid_argument("rollup level " + levels[i].name + " is not a multiple of the level below");
+        }
+        std::unique_ptr<Level> level(new Level{ levels[i], WindowAggregator(resolution), nullptr });
+        if (levels[i].retention.enabled()) {
+            level->rotator.reset(new LogRotator(levels[i].path, levels[i].retention));
+        }
+        levels_.push_back(std::move(level));
+    }
+}
+
+void RollupEngine::windowClosed(std::size_t level, const ClosedWindow& window, bool log) {
+    Level& current = *levels_[level];
+    if (log) {
+        if (current.rotator) {
+            current.rotator->rotate_if_needed();
+        }
+        logWindow(current.config.path, window);
+    }
+    if (level + 1 < levels_.size()) {
+        ClosedWindow next;
+        if (levels_[level + 1]->aggregator.merge(window.start, window.stats, next)) {
+            windowClosed(level + 1, next, log);
+        }
+    }
+}
+
+void RollupEngine::addSample(std::time_t timestamp, float value) {
+    ClosedWindow closed;
+    if (levels_[0]->aggregator.add(timestamp, value, closed)) {
+        windowClosed(0, closed, true);
+    }
+}
+
+void RollupEngine::tick(std::time_t now) {
+    // Bottom up, so a level has received its last window before it is checked.
+    for (std::size_t level = 0; level < levels_.size(); ++level) {
+        ClosedWindow closed;
+        if (levels_[level]->aggregator.closeIfEnded(now, closed)) {
+            windowClosed(level, closed, true);
+        }
+    }
+}
+
+void RollupEngine::restore(const std::vector<std::pair<std::time_t, float>>& samples) {
+    for (const auto& sample : samples) {
+        ClosedWindow closed;
+        if (levels_[0]->aggregator.add(sample.first, sample.second, closed)) {
+            windowClosed(0, closed, false);
+        }
+    }
+}
+
+std::time_t RollupEngine::restoreFrom(std::time_t now) const {
+    return windowStart(levels_.back()->config.resolution, now);
+}
+
+namespace {
+
+// Calls onLine for every line of a rollup log, plain or gzip-compressed.
+template <typename OnLine>
+void forEachLine(const std::string& path, OnLine onLine) {
+    if (path.size() > 3 && path.compare(path.size() - 3, 3, ".gz") == 0) {
+#ifdef LOG_ROTATION_GZIP
+        gzFile in = gzopen(path.c_str(), "rb");
+        if (!in) {
+            return;
+        }
+        std::string line;
+        char chunk[64 * 1024];
+        int read;
+        while ((read = gzread(in, chunk, sizeof(chunk))) > 0) {
+            for (int i = 0; i < read; ++i) {
+                if (chunk[i] == '\n') {
+                    onLine(line);
+                    line.clear();
+                } else {
+                    line += chunk[i];
+                }
+            }
+        }
+        gzclose(in);
+#endif
+        return;
+    }
+    std::ifstream in(path);
+    std::string line;
+    while (std::getline(in, line)) {
+        onLine(line);
+    }
+}
+
+}
+
+WindowStats readRollup(const std::string& path, std::time_t from, std::time_t to) {
+    WindowStats result;
+    auto mergeLine = [&](const std::string& line) {
+        ClosedWindow window;
+        if (parseWindow(line, window) && window.start >= from && window.start < to) {
+            result.merge(window.stats);
+        }
+    };
+
+    // Rotated files only hold windows logged before their rotation time and
+    // windows are logged after they start, so older files cannot overlap.
+    auto rotated = LogRotator::rotated_files(path);
+    for (const auto& file : rotated) {
+        // While a file is being compressed both copies exist for a moment.
+        bool compressed = std::any_of(rotated.begin(), rotated.end(),
+                                      [&](const auto& other) { return other.first == file.first + ".gz"; });
+        if (file.second >= from && !compressed) {
+            forEachLine(file.first, mergeLine);
+        }
+    }
+    forEachLine(path, mergeLine);
+    return result;
+}
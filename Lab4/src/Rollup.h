@@ -0,0 +1,62 @@
+#ifndef ROLLUP_H
+#define ROLLUP_H
+
+#include <ctime>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include "LogRotator.h"
+#include "StreamingAggregate.h"
+
+struct RollupLevelConfig {
+    std::string name;          // "1m", "1h", ...
+    Resolution resolution;
+    std::string path;          // finished windows are appended here, see logWindow()
+    RotationPolicy retention;  // how the log is rotated and how long rotated files are kept
+};
+
+// Cascade of window aggregates from the finest resolution to the coarsest.
+// Samples only update the first level; every finished window is logged and
+// merged into the next level, so each level is computed from the one below
+// and is still exact. Every level's length must be a whole multiple of the
+// previous one (a local day counts as 24 hours), so no window straddles two
+// windows of the next level. Throws std::invalid_argument otherwise.
+class RollupEngine {
+public:
+    explicit RollupEngine(const std::vector<RollupLevelConfig>& levels);
+
+    void addSample(std::time_t timestamp, float value);
+
+    // Closes windows whose end has passed, call it periodically.
+    void tick(std::time_t now);
+
+    // Feeds stored samples after a restart. Windows finished by them were
+    // logged by the previous run and are only merged upwards.
+    void restore(const std::vector<std::pair<std::time_t, float>>& samples);
+
+    // Start of the coarsest window containing `now`: restoring samples from
+    // there rebuilds the state of every level.
+    std::time_t restoreFrom(std::time_t now) const;
+
+private:
+    struct Level {
+        RollupLevelConfig config;
+        WindowAggregator aggregator;
+        std::unique_ptr<LogRotator> rotator;
+    };
+
+    // Handles a finished window of `level` and everything it finishes above.
+    void windowClosed(std::size_t level, const ClosedWindow& window, bool log);
+
+    std::vector<std::unique_ptr<Level>> levels_;
+};
+
+// Merged statistics of the windows in a rollup log that start in
+// [from, to). Percentiles of any range come from merging the stored
+// sketches, so the raw samples are not read; pick the coarsest level whose
+// windows are short enough for the range. Rotated copies of the log
+// (LogRotator) that may hold windows of the range are read as well.
+WindowStats readRollup(const std::string& path, std::time_t from, std::time_t to);
+
+#endif
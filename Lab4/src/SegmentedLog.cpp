@@ -0,0 +1,87 @@
+#include "SegmentedLog.h"
+#include <algorithm>
+#include <filesystem>
+#include "MappedLogReader.h"
+#include <system_error>
+
+SegmentedLog::SegmentedLog(std::string directory, int segmentSeconds, int retentionSeconds, FlushPolicy flushPolicy)
+    : directory_(std::move(directory)), segmentSeconds_(segmentSeconds), retentionSeconds_(retentionSeconds),
+      current_(flushPolicy) {
+    std::filesystem::create_directories(directory_);
+    dropExpiredSegments(std::time(nullptr));
+}
+
+std::time_t SegmentedLog::segmentStart(std::time_t timestamp) const {
+    return timestamp - timestamp % segmentSeconds_;
+}
+
+std::string SegmentedLog::segmentPath(std::time_t start) const {
+    return directory_ + "/" + std::to_string(start) + ".log";
+}
+
+std::vector<std::pair<std::time_t, std::string>> SegmentedLog::listSegments() const {
+    std::vector<std::pair<std::time_t, std::string>> segments;
+    std::error_code error;
+    for (std::filesystem::directory_iterator it(directory_, error), end; !error && it != end; it.increment(error)) {
+        if (it->path().extension() != ".log") {
+            continue;
+        }
+        std::string stem = it->path().stem().string();
+        if (stem.empty() || stem.find_first_not_of("0123456789") != std::string::npos) {
+            continue;
+        }
+        segments.emplace_back(static_cast<std::time_t>(std::stoll(stem)), it->path().string());
+    }
+    std::sort(segments.begin(), segments.end());
+    return segments;
+}
+
+void SegmentedLog::dropExpiredSegments(std::time_t now) {
+    std::error_code error;
+    for (const auto& segment : listSegments()) {
+        if (segment.first + segmentSeconds_ > now - retentionSeconds_) {
+            break;
+        }
+        std::filesystem::remove(segment.second, error);
+    }
+}
+
+void SegmentedLog::append(std::time_t timestamp, float value) {
+    std::time_t start = segmentStart(timestamp);
+    if (start != currentStart_) {
+        current_.open(segmentPath(start));
+        currentStart_ = start;
+        // Segments only expire on a segment boundary, no need to look earlier.
+        dropExpiredSegments(timestamp);
+    }
+    current_.appendSample(timestamp, value);
+}
+
+void SegmentedLog::flushIfDue() {
+    current_.flushIfDue();
+}
+
+std::vector<std::pair<std::time_t, float>> SegmentedLog::readSince(std::time_t from) {
+    current_.flush();
+    std::vector<std::pair<std::time_t, float>> samples;
+    for (const auto& segment : listSegments()) {
+        if (segment.first + segmentSeconds_ <= from) {
+            continue;
+        }
+        auto segmentSamples = readLogSince(segment.second, from);
+        samples.insert(samples.end(), segmentSamples.begin(), segmentSamples.end());
+    }
+    return samples;
+}
+
+void SegmentedLog::importLegacyLog(const std::string& path) {
+    std::error_code error;
+    if (!std::filesystem::exists(path, error)) {
+        return;
+    }
+    for (const auto& sample : readLogSince(path, std::time(nullptr) - retentionSeconds_)) {
+        append(sample.first, sample.second);
+    }
+    current_.flush();
+    std::filesystem::remove(path, error);
+}
@@ -0,0 +1,51 @@
+#ifndef SEGMENTED_LOG_H
+#define SEGMENTED_LOG_H
+
+#include <ctime>
+#include <string>
+#include <utility>
+#include <vector>
+#include "BufferedLogWriter.h"
+
+// Time-partitioned, append-only log of "<unix time> <value>" lines. Every
+// segmentSeconds of samples go to their own file "<directory>/<start>.log",
+// named after the first second the file covers. Files are never rewritten:
+// a sample is one appended line, and retention removes whole segments once
+// their last second is older than retentionSeconds, so the cost of a sample
+// does not depend on how much history is kept. Samples go through a
+// BufferedLogWriter with the given flush policy.
+class SegmentedLog {
+public:
+    SegmentedLog(std::string directory, int segmentSeconds, int retentionSeconds,
+                 FlushPolicy flushPolicy = FlushPolicy());
+
+    void append(std::time_t timestamp, float value);
+
+    // Call periodically, writes out buffered samples once they are old enough.
+    void flushIfDue();
+
+    // Samples with timestamp >= from, oldest first, including buffered ones.
+    // Only the segments that can hold such samples are read.
+    std::vector<std::pair<std::time_t, float>> readSince(std::time_t from);
+
+    // Moves the samples of an old single-file log that are still within
+    // retention into segments and removes the file.
+    void importLegacyLog(const std::string& path);
+
+private:
+    std::time_t segmentStart(std::time_t timestamp) const;
+    std::string segmentPath(std::time_t start) const;
+
+    // Start times and paths of all segments, oldest first.
+    std::vector<std::pair<std::time_t, std::string>> listSegments() const;
+
+    void dropExpiredSegments(std::time_t now);
+
+    std::string directory_;
+    int segmentSeconds_;
+    int retentionSeconds_;
+    BufferedLogWriter current_;
+    std::time_t currentStart_ = -1;
+};
+
+#endif
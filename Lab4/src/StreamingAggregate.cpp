@@ -0,0 +1,187 @@
+#include "StreamingAggregate.h"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <utility>
+
+void WindowStats::add(float value) {
+    if (count == 0) {
+        min = value;
+        max = value;
+    } else {
+        min = std::min(min, value);
+        max = std::max(max, value);
+    }
+    ++count;
+    sum += value;
+    sumSquares += static_cast<double>(value) * value;
+    quantiles.add(value);
+}
+
+void WindowStats::merge(const WindowStats& other) {
+    if (other.count == 0) {
+        return;
+    }
+    if (count == 0) {
+        *this = other;
+        return;
+    }
+    count += other.count;
+    sum += other.sum;
+    sumSquares += other.sumSquares;
+    min = std::min(min, other.min);
+    max = std::max(max, other.max);
+    quantiles.merge(other.quantiles);
+}
+
+double WindowStats::mean() const {
+    return count == 0 ? 0 : sum / static_cast<double>(count);
+}
+
+double WindowStats::stddev() const {
+    if (count == 0) {
+        return 0;
+    }
+    double m = mean();
+    return std::sqrt(std::max(0.0, sumSquares / static_cast<double>(count) - m * m));
+}
+
+double WindowStats::quantile(double q) const {
+    if (count == 0) {
+        return 0;
+    }
+    // The extremes are known exactly, the sketch only approximates them.
+    if (q <= 0) {
+        return min;
+    }
+    if (q >= 1) {
+        return max;
+    }
+    return std::min<double>(max, std::max<double>(min, quantiles.quantile(q)));
+}
+
+namespace {
+
+std::tm localTime(std::time_t timestamp) {
+    std::tm local{};
+#ifdef _WIN32
+    localtime_s(&local, &timestamp);
+#else
+    localtime_r(&timestamp, &local);
+#endif
+    return local;
+}
+
+// Seconds the local clock is ahead of UTC at `timestamp`.
+std::time_t utcOffset(std::time_t timestamp) {
+    std::tm local = localTime(timestamp);
+    // Days since the epoch of the local date (days_from_civil).
+    long long year = local.tm_year + 1900 - (local.tm_mon < 2 ? 1 : 0);
+    long long era = (year >= 0 ? year : year - 399) / 400;
+    long long yearOfEra = year - era * 400;
+    long long month = local.tm_mon + 1;
+    long long dayOfYear = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + local.tm_mday - 1;
+    long long dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+    long long days = era * 146097 + dayOfEra - 719468;
+    long long localSeconds = days * 86400 + local.tm_hour * 3600 + local.tm_min * 60 + local.tm_sec;
+    return static_cast<std::time_t>(localSeconds - timestamp);
+}
+
+} // namespace
+
+std::time_t windowStart(Resolution resolution, std::time_t timestamp) {
+    if (!resolution.localDay) {
+        std::time_t local = timestamp + utcOffset(timestamp);
+        std::time_t intoWindow = local % resolution.seconds;
+        if (intoWindow < 0) {
+            intoWindow += resolution.seconds;
+        }
+        return timestamp - intoWindow;
+    }
+    std::tm local = localTime(timestamp);
+    local.tm_hour = 0;
+    local.tm_min = 0;
+    local.tm_sec = 0;
+    local.tm_isdst = -1;
+    return std::mktime(&local);
+}
+
+std::time_t windowEnd(Resolution resolution, std::time_t start) {
+    if (!resolution.localDay) {
+        return start + resolution.seconds;
+    }
+    std::tm local = localTime(start);
+    local.tm_mday += 1;
+    local.tm_isdst = -1;
+    return std::mktime(&local);
+}
+
+WindowAggregator::WindowAggregator(Resolution resolution) : resolution_(resolution) {
+}
+
+bool WindowAggregator::advance(std::time_t timestamp, ClosedWindow& closed) {
+    if (start_ != -1 && timestamp < end_) {
+        return false;
+    }
+    bool hadWindow = start_ != -1 && stats_.count > 0;
+    if (hadWindow) {
+        closed.start = start_;
+        closed.stats = stats_;
+    }
+    start_ = windowStart(resolution_, timestamp);
+    end_ = windowEnd(resolution_, start_);
+    stats_ = WindowStats();
+    return hadWindow;
+}
+
+bool WindowAggregator::add(std::time_t timestamp, float value, ClosedWindow& closed) {
+    bool result = advance(timestamp, closed);
+    stats_.add(value);
+    return result;
+}
+
+bool WindowAggregator::merge(std::time_t timestamp, const WindowStats& stats, ClosedWindow& closed) {
+    bool result = advance(timestamp, closed);
+    stats_.merge(stats);
+    return result;
+}
+
+bool WindowAggregator::closeIfEnded(std::time_t now, ClosedWindow& closed) {
+    if (start_ == -1 || now < end_ || stats_.count == 0) {
+        return false;
+    }
+    closed.start = start_;
+    closed.stats = stats_;
+    start_ = -1;
+    end_ = -1;
+    stats_ = WindowStats();
+    return true;
+}
+
+void logWindow(const std::string& path, const ClosedWindow& window) {
+    std::string sketch;
+    window.stats.quantiles.appendTo(sketch);
+    std::ofstream out(path, std::ios::app);
+    out << window.start << " " << window.stats.mean() << " " << window.stats.count << " " << window.stats.min << " "
+        << window.stats.max << " " << window.stats.stddev() << " " << sketch << "\n";
+}
+
+bool parseWindow(const std::string& line, ClosedWindow& window) {
+    std::istringstream in(line);
+    double mean = 0;
+    double stddev = 0;
+    WindowStats stats;
+    if (!(in >> window.start >> mean >> stats.count >> stats.min >> stats.max >> stddev)) {
+        return false;
+    }
+    std::string sketch;
+    if (in >> sketch && !stats.quantiles.parse(sketch.data(), sketch.data() + sketch.size())) {
+        return false;
+    }
+    // Six significant digits are logged, so the sums are approximate.
+    stats.sum = mean * static_cast<double>(stats.count);
+    stats.sumSquares = (stddev * stddev + mean * mean) * static_cast<double>(stats.count);
+    window.stats = std::move(stats);
+    return true;
+}
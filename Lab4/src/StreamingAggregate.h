@@ -0,0 +1,84 @@
+#ifndef STREAMING_AGGREGATE_H
+#define STREAMING_AGGREGATE_H
+
+#include <cstdint>
+#include <ctime>
+#include <string>
+#include "QuantileSketch.h"
+
+// Running statistics of one window. Merging another window gives exactly
+// what adding all of its samples would have given, so coarser windows are
+// built from finer ones. Besides the moments it keeps a quantile sketch,
+// whose size depends on the spread of the values, not on their number.
+struct WindowStats {
+    std::uint64_t count = 0;
+    double sum = 0;
+    double sumSquares = 0;
+    float min = 0;
+    float max = 0;
+    QuantileSketch quantiles;
+
+    void add(float value);
+    void merge(const WindowStats& other);
+
+    double mean() const;
+    double stddev() const; // population standard deviation
+    double quantile(double q) const; // see QuantileSketch::quantile()
+};
+
+// Window length. All windows are aligned to local time, so the finer ones
+// nest in local days also in zones with a half-hour offset and on DST
+// change days: a fixed window starts at a multiple of its length since the
+// local midnight of the epoch, a local day runs from local midnight to the
+// next one and is 23 to 25 hours long.
+struct Resolution {
+    int seconds = 3600;
+    bool localDay = false;
+
+    static Resolution fixed(int seconds) { return { seconds, false }; }
+    static Resolution day() { return { 24 * 3600, true }; }
+};
+
+std::time_t windowStart(Resolution resolution, std::time_t timestamp);
+std::time_t windowEnd(Resolution resolution, std::time_t start);
+
+struct ClosedWindow {
+    std::time_t start;
+    WindowStats stats;
+};
+
+// Aggregates samples (or finished finer windows) into consecutive
+// wall-clock-aligned windows and hands out each window once it is over.
+// Input is expected in time order; a sample older than the current window
+// is counted in the current one.
+class WindowAggregator {
+public:
+    explicit WindowAggregator(Resolution resolution);
+
+    // Both return true and fill `closed` when the input starts a later
+    // window, the input then goes into the new one.
+    bool add(std::time_t timestamp, float value, ClosedWindow& closed);
+    bool merge(std::time_t timestamp, const WindowStats& stats, ClosedWindow& closed);
+
+    // Returns the current window once `now` is past its end, so a window
+    // is reported even when no later input arrives.
+    bool closeIfEnded(std::time_t now, ClosedWindow& closed);
+
+private:
+    bool advance(std::time_t timestamp, ClosedWindow& closed);
+
+    Resolution resolution_;
+    std::time_t start_ = -1;
+    std::time_t end_ = -1;
+    WindowStats stats_;
+};
+
+// Appends "<window start> <mean> <count> <min> <max> <stddev> <sketch>". The
+// first two columns keep the format of the other logs.
+void logWindow(const std::string& path, const ClosedWindow& window);
+
+// Parses a line written by logWindow(). Lines written before the sketch
+// column existed are accepted with an empty sketch.
+bool parseWindow(const std::string& line, ClosedWindow& window);
+
+#endif
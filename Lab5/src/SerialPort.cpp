@@ -52,18 +52,6 @@ void writeToSerial(HANDLE hSerial, const std::string& data) {
     }
 }
 
-std::string readFromSerial(HANDLE hSerial) {
-    char buffer[64] = {0};
-    DWORD bytesRead = 0;
-    if (ReadFile(hSerial, buffer, sizeof(buffer) - 1, &bytesRead, nullptr)) {
-        buffer[bytesRead] = '\0';
-        return std::string(buffer);
-    } else {
-        std::cerr << "Error reading from serial port\n";
-        return "";
-    }
-}
-
 #else
 #include <fcntl.h>
 int initializeSerialPort(const std::string& port) {
@@ -113,15 +101,4 @@ void writeToSerial(int fd, const std::string& data) {
     }
 }
 
-std::string readFromSerial(int fd) {
-    char buffer[64] = {0};
-    int bytesRead = read(fd, buffer, sizeof(buffer) - 1);
-    if (bytesRead > 0) {
-        buffer[bytesRead] = '\0';
-        return std::string(buffer);
-    } else {
-        perror("Error reading from serial port");
-        return "";
-    }
-}
 #endif
@@ -12,6 +12,7 @@
 #include <sqlite3.h>
 #include "httplib.h"
 #include "SerialPort.h"
+#include "SerialLineReader.h"
 
 #ifdef _WIN32
 #include <windows.h>
@@ -89,9 +90,7 @@ std::vector<std::pair<std::time_t, float>> queryTemperature(sqlite3* db, int sta
 }
 
 // HTTP-сервер
-void startServer(sqlite3* db) {
-    httplib::Server svr;
-
+void startServer(httplib::Server& svr, sqlite3* db) {
     svr.Get("/current", [db](const httplib::Request& req, httplib::Response& res) {
         auto results = queryTemperature(db, std::time(nullptr) - 60, std::time(nullptr));
         if (results.empty()) {
@@ -155,29 +154,36 @@ int main() {
         return 1;
     }
 
-    std::thread serverThread(startServer, db);
-
-    while (true) {
-        auto data = readFromSerial(serialPort);
-        if (!data.empty()) {
-            try {
-                float temperature = std::stof(data);
-                logTemperatureToDatabase(db, temperature);
-                std::cout << "Logged: " << std::fixed << std::setprecision(2) << temperature << "\n";
-            } catch (...) {
-                std::cerr << "Failed to parse temperature.\n";
+    httplib::Server svr;
+    std::thread serverThread(startServer, std::ref(svr), db);
+
+    // Every reading is stored as soon as its line arrives.
+    SerialLineReader serialReader(serialPort);
+    bool portOpen = true;
+    while (portOpen) {
+        portOpen = serialReader.poll(std::chrono::seconds(1), [&](std::string_view frame) {
+            float temperature;
+            if (!parseReading(frame, temperature)) {
+                std::cerr << "Failed to parse temperature: " << frame << "\n";
+                return;
             }
-        }
-        std::this_thread::sleep_for(std::chrono::seconds(1));
+            logTemperatureToDatabase(db, temperature);
+            std::cout << "Logged: " << std::fixed << std::setprecision(2) << temperature << "\n";
+        });
     }
 
+    // The port failed or was closed. listen() returns once the server is
+    // stopped and its handlers are done, only then may the database go.
+    svr.wait_until_ready();
+    svr.stop();
+    serverThread.join();
+
 #ifdef _WIN32
     CloseHandle(serialPort);
 #else
     close(serialPort);
 #endif
     sqlite3_close(db);
-    serverThread.join();
 
-    return 0;
+    return 1;
 }